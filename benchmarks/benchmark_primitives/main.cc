@@ -0,0 +1,216 @@
+#define ROCKY_USE_MPI
+#include <rocky/zagros/benchmark.h>
+#include <rocky/zagros/flow.h>
+#include <nlohmann/json.hpp>
+
+#include<chrono>
+#include<cstdlib>
+
+using namespace rocky;
+using namespace zagros::dena;
+using namespace std::chrono;
+
+typedef float solution_type;
+
+// minimum measuring time for each primitive in seconds
+const double min_time = 0.2;
+// bounds on the number of measured iterations
+const int min_iters = 5;
+const int max_iters = 10000;
+
+/**
+ * @brief time a primitive and encode the result as a benchmark record
+ * `setup` runs before every iteration and is excluded from the measurement
+ *
+ */
+template<typename T_fn, typename T_setup>
+nlohmann::json measure(std::string primitive, int dim, int n_particles, int n_threads, T_fn fn, T_setup setup){
+    // warm up
+    setup();
+    fn();
+    std::vector<double> samples;
+    double total = 0.0;
+    while((total < min_time || samples.size() < min_iters) && samples.size() < max_iters){
+        setup();
+        auto start = high_resolution_clock::now();
+        fn();
+        auto end = high_resolution_clock::now();
+        double elapsed = duration<double, std::micro>(end - start).count();
+        samples.push_back(elapsed);
+        total += elapsed * 1e-6;
+    }
+    std::sort(samples.begin(), samples.end());
+    double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    double var = 0.0;
+    for(auto s: samples)
+        var += (s - mean) * (s - mean);
+    var /= samples.size();
+
+    nlohmann::json record = {{"name", fmt::format("{}/dim:{}/particles:{}/threads:{}", primitive, dim, n_particles, n_threads)},
+                             {"primitive", primitive},
+                             {"dim", dim},
+                             {"n_particles", n_particles},
+                             {"threads", n_threads},
+                             {"iterations", samples.size()},
+                             {"real_time", mean},
+                             {"median_time", samples[samples.size()/2]},
+                             {"min_time", samples.front()},
+                             {"stddev", std::sqrt(var)},
+                             {"time_unit", "us"}};
+    fmt::print("{} : {:.3f} us\n", record["name"].get<std::string>(), mean);
+    return record;
+}
+
+template<typename T_fn>
+nlohmann::json measure(std::string primitive, int dim, int n_particles, int n_threads, T_fn fn){
+    return measure(primitive, dim, n_particles, n_threads, fn, [](){});
+}
+
+/**
+ * @brief benchmark container operations and search strategies for a fixed dimension
+ *
+ */
+template<int T_dim>
+void run_suite(nlohmann::json& results, int n_particles, int n_threads){
+    typedef zagros::basic_scontainer<solution_type, T_dim> container_type;
+    const int group_size = std::max(n_particles / 10, 1);
+
+    zagros::benchmark::rastrigin<solution_type> problem(T_dim);
+
+    container_type main_cnt(n_particles, group_size);
+    main_cnt.allocate();
+    container_type candidates(n_particles, n_particles);
+    candidates.allocate();
+
+    zagros::uniform_init_strategy<solution_type, T_dim> init_main(&problem, &main_cnt);
+    zagros::uniform_init_strategy<solution_type, T_dim> init_candidates(&problem, &candidates);
+    // restore a freshly initialized and evaluated population
+    auto reinit = [&](){
+        init_main.apply();
+        main_cnt.evaluate_and_update(&problem);
+        init_candidates.apply();
+        candidates.evaluate_and_update(&problem);
+    };
+    reinit();
+
+    // container operations
+    results.push_back(measure("evaluate_and_update", T_dim, n_particles, n_threads, [&](){
+        main_cnt.evaluate_and_update(&problem);
+    }));
+    std::vector<int> indices(n_particles);
+    results.push_back(measure("best_k", T_dim, n_particles, n_threads, [&](){
+        main_cnt.best_k(indices.data(), n_particles / 2);
+    }));
+    results.push_back(measure("sample_n_particles", T_dim, n_particles, n_threads, [&](){
+        main_cnt.sample_n_particles(indices.data(), 4);
+    }));
+    std::vector<solution_type> main_values = main_cnt.values;
+    std::vector<solution_type> candidates_values = candidates.values;
+    results.push_back(measure("replace_with", T_dim, n_particles, n_threads, [&](){
+        main_cnt.replace_with(&candidates);
+    }, [&](){
+        main_cnt.values = main_values;
+        candidates.values = candidates_values;
+    }));
+
+    // particle swarm phases
+    reinit();
+    container_type particles_v(n_particles, group_size);
+    container_type particles_best(n_particles, group_size);
+    container_type groups_best(main_cnt.n_groups(), 1);
+    container_type node_best(1, 1);
+    container_type cluster_best(1, 1);
+    for(auto cnt: {&particles_v, &particles_best, &groups_best, &node_best, &cluster_best})
+        cnt->allocate();
+    zagros::pso_l1_strategy<solution_type, T_dim> pso_l1(&problem, &main_cnt, &particles_v, &particles_best, &groups_best, &node_best, &cluster_best);
+    zagros::basic_pso<solution_type, T_dim>* pso = &pso_l1;
+    pso->reset();
+    pso->apply();
+    results.push_back(measure("pso_update_particles_best", T_dim, n_particles, n_threads, [&](){ pso->update_particles_best(); }));
+    results.push_back(measure("pso_update_groups_best", T_dim, n_particles, n_threads, [&](){ pso->update_groups_best(); }));
+    results.push_back(measure("pso_update_node_best", T_dim, n_particles, n_threads, [&](){ pso->update_node_best(); }));
+    results.push_back(measure("pso_update_cluster_best", T_dim, n_particles, n_threads, [&](){ pso->update_cluster_best(); }));
+    results.push_back(measure("pso_update_particles_v", T_dim, n_particles, n_threads, [&](){ pso->update_particles_v(); }));
+    results.push_back(measure("pso_update_particles_x", T_dim, n_particles, n_threads, [&](){ pso->update_particles_x(); }));
+    results.push_back(measure("pso_l1_step", T_dim, n_particles, n_threads, [&](){ pso->apply(); }));
+
+    // differential evolution
+    reinit();
+    zagros::basic_differential_evolution<solution_type, T_dim> de(&problem, &main_cnt, &candidates);
+    results.push_back(measure("differential_evolution", T_dim, n_particles, n_threads, [&](){ de.apply(); }));
+
+    // gaussian mutation
+    reinit();
+    zagros::gaussian_mutation<solution_type, T_dim> mutation(&problem, &main_cnt, &candidates, 1, 0.0, 1.0);
+    results.push_back(measure("gaussian_mutation", T_dim, n_particles, n_threads, [&](){ mutation.apply(); }));
+
+    // estimation of distribution phases
+    reinit();
+    zagros::eda_mutivariate_normal<solution_type, T_dim> eda(&problem, &main_cnt, &candidates, std::max(n_particles / 2, 2));
+    results.push_back(measure("eda_mvn_estimate", T_dim, n_particles, n_threads, [&](){ eda.estimate_distribution(); }));
+    results.push_back(measure("eda_mvn_cholesky", T_dim, n_particles, n_threads, [&](){ eda.decompose(); }));
+    results.push_back(measure("eda_mvn_sample", T_dim, n_particles, n_threads, [&](){ eda.sample_candidates(); }));
+}
+
+/**
+ * @brief overhead of the flow interpreter for a node whose strategy is almost free
+ *
+ */
+void run_flow_overhead(nlohmann::json& results, int n_threads){
+    const int dim = 2;
+    const int n_visits = 10000;
+    zagros::benchmark::sphere<solution_type> problem(dim);
+    auto f = container::create("A", 1)
+             >> container::create("B", 1)
+             >> run::n_times(n_visits, container::take_best("A", "B"));
+    auto record = measure("flow_interpreter", dim, 1, n_threads, [&](){
+        zagros::basic_runtime<solution_type, dim> runtime(&problem);
+        runtime.run(f);
+    });
+    record["node_visits"] = n_visits;
+    record["time_per_visit"] = record["real_time"].get<double>() / n_visits;
+    results.push_back(record);
+}
+
+int main(int argc, char* argv[]){
+    MPI_Init(&argc, &argv);
+    spdlog::set_level(spdlog::level::warn);
+
+    // maximum number of threads, the benchmark sweeps powers of two up to this value
+    int max_threads = (argc > 1) ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+    std::string output_path = (argc > 2) ? argv[2] : "primitives.json";
+
+    std::vector<int> particles {100, 1000};
+    std::vector<int> threads;
+    for(int t=1; t<max_threads; t*=2)
+        threads.push_back(t);
+    threads.push_back(max_threads);
+
+    nlohmann::json results = nlohmann::json::array();
+    for(auto n_threads: threads){
+        tbb::global_control thread_limit(tbb::global_control::max_allowed_parallelism, n_threads);
+        for(auto n_particles: particles){
+            run_suite<10>(results, n_particles, n_threads);
+            run_suite<100>(results, n_particles, n_threads);
+            run_suite<1000>(results, n_particles, n_threads);
+        }
+        run_flow_overhead(results, n_threads);
+    }
+
+    const char* commit = std::getenv("ROCKY_BENCHMARK_COMMIT");
+    auto now = system_clock::to_time_t(system_clock::now());
+    std::string date = std::ctime(&now);
+    date.pop_back();
+    nlohmann::json report = {{"context", {{"date", date},
+                                          {"commit", commit ? commit : ""},
+                                          {"num_cpus", std::thread::hardware_concurrency()},
+                                          {"max_threads", max_threads},
+                                          {"solution_type", "float"}}},
+                             {"benchmarks", results}};
+    std::fstream fh(output_path, std::fstream::out);
+    fh << report.dump(2) << std::endl;
+    fh.close();
+
+    MPI_Finalize();
+    return 0;
+}
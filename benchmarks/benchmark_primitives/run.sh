@@ -0,0 +1,6 @@
+#!/usr/bin/env bash
+# usage: run.sh <max_threads> <n_procs>
+# the primitives run on a single process and sweep thread counts internally
+max_threads=${1:-4}
+
+mpirun -np 1 --use-hwthread-cpus ./app ${max_threads} ../result/primitives.json
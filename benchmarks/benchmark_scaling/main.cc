@@ -0,0 +1,169 @@
+#define ROCKY_USE_MPI
+#include <rocky/zagros/benchmark.h>
+#include <rocky/zagros/flow.h>
+#include <nlohmann/json.hpp>
+
+#include<chrono>
+#include<cstdlib>
+#include<tuple>
+#include<algorithm>
+
+using namespace rocky;
+using namespace zagros::dena;
+
+typedef float solution_type;
+
+// accumulated time spent inside MPI collectives on this process
+static double comm_seconds = 0.0;
+
+// the runtime communicates through these collectives
+// they are intercepted with the MPI profiling interface to measure the communication share
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm){
+    double start = PMPI_Wtime();
+    int result = PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+    comm_seconds += PMPI_Wtime() - start;
+    return result;
+}
+int MPI_Bcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm){
+    double start = PMPI_Wtime();
+    int result = PMPI_Bcast(buffer, count, datatype, root, comm);
+    comm_seconds += PMPI_Wtime() - start;
+    return result;
+}
+
+const int dim = 100;
+const int bcd_dim = 1000;
+const int bcd_block_dim = 100;
+const int n_iters = 50;
+const int n_repeats = 3;
+// total number of particles in strong scaling
+const int strong_particles = 2048;
+// number of particles per core in weak scaling
+const int weak_particles = 256;
+
+flow pso_flow(int n_particles){
+    return container::create("A", n_particles, std::max(n_particles / 8, 1))
+           >> pso::memory::create("M", "A")
+           >> init::uniform("A")
+           >> run::n_times(n_iters,
+                  pso::local::step("M", "A")
+                  >> pso::global::step("M", "A")
+                  >> propagate::cluster::best(pso::memory::cluster_mem("M")));
+}
+
+flow de_flow(int n_particles){
+    return container::create("A", n_particles)
+           >> init::uniform("A")
+           >> container::eval("A")
+           >> run::n_times(n_iters,
+                  crossover::differential_evolution("A")
+                  >> propagate::cluster::best("__best__"));
+}
+
+flow eda_flow(int n_particles){
+    return container::create("A", n_particles)
+           >> init::uniform("A")
+           >> container::eval("A")
+           >> run::n_times(n_iters,
+                  eda::mvn::full_cov("A")
+                  >> propagate::cluster::best("__best__"));
+}
+
+flow bcd_flow(int n_particles){
+    return container::create("A", n_particles)
+           >> init::uniform("A")
+           >> run::n_times(n_iters / 5,
+                  block::uniform::select()
+                  >> container::eval("A")
+                  >> run::n_times(5, crossover::differential_evolution("A")));
+}
+
+/**
+ * @brief run a flow several times and return the median wall time
+ * the wall time is the slowest process and communication is averaged over processes
+ */
+template<int T_dim, int T_block_dim>
+std::pair<double, double> time_flow(flow (*make_flow)(int), int n_particles, zagros::system<solution_type>* problem){
+    std::vector<std::pair<double, double>> samples;
+    int n_procs;
+    MPI_Comm_size(MPI_COMM_WORLD, &n_procs);
+    for(int r=0; r<n_repeats; r++){
+        auto f = make_flow(n_particles);
+        PMPI_Barrier(MPI_COMM_WORLD);
+        comm_seconds = 0.0;
+        double start = PMPI_Wtime();
+        zagros::basic_runtime<solution_type, T_dim, T_block_dim> runtime(problem);
+        runtime.run(f);
+        double elapsed = PMPI_Wtime() - start;
+        double local[2] = {elapsed, comm_seconds};
+        double wall, comm;
+        PMPI_Allreduce(&local[0], &wall, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        PMPI_Allreduce(&local[1], &comm, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        samples.push_back(std::make_pair(wall, comm / n_procs));
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size()/2];
+}
+
+int main(int argc, char* argv[]){
+    MPI_Init(&argc, &argv);
+    spdlog::set_level(spdlog::level::warn);
+    int rank, n_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &n_procs);
+
+    // usage: app <strong|weak> <threads per process> <output file>
+    std::string mode = (argc > 1) ? argv[1] : "strong";
+    int n_threads = (argc > 2) ? std::atoi(argv[2]) : 1;
+    std::string output_path = (argc > 3) ? argv[3] : "scaling.jsonl";
+    tbb::global_control thread_limit(tbb::global_control::max_allowed_parallelism, n_threads);
+
+    int n_cores = n_procs * n_threads;
+    // particles on this process
+    int n_particles;
+    if(mode == "strong")
+        n_particles = strong_particles / n_procs;
+    else
+        n_particles = weak_particles * n_threads;
+
+    zagros::benchmark::rastrigin<solution_type> problem(dim);
+    zagros::benchmark::rastrigin<solution_type> bcd_problem(bcd_dim);
+
+    // a full covariance needs at least dim samples per process, so in strong scaling
+    // the population stops shrinking beyond strong_particles / dim processes and the
+    // total work grows, the report accounts for it with the recorded particles
+    // EDA in weak scaling has at least weak_particles >= dim particles
+    int eda_particles = std::max(n_particles, dim);
+
+    // flow name, particles on this process and timing
+    std::vector<std::tuple<std::string, int, std::pair<double, double>>> timings;
+    timings.push_back({"pso", n_particles, time_flow<dim, dim>(pso_flow, n_particles, &problem)});
+    timings.push_back({"de", n_particles, time_flow<dim, dim>(de_flow, n_particles, &problem)});
+    timings.push_back({"eda", eda_particles, time_flow<dim, dim>(eda_flow, eda_particles, &problem)});
+    timings.push_back({"bcd", n_particles, time_flow<bcd_dim, bcd_block_dim>(bcd_flow, n_particles, &bcd_problem)});
+
+    if(rank == 0){
+        const char* commit = std::getenv("ROCKY_BENCHMARK_COMMIT");
+        std::fstream fh(output_path, std::fstream::out | std::fstream::app);
+        for(auto& [name, particles, timing]: timings){
+            nlohmann::json record = {{"flow", name},
+                                     {"mode", mode},
+                                     {"procs", n_procs},
+                                     {"threads", n_threads},
+                                     {"cores", n_cores},
+                                     {"particles_per_proc", particles},
+                                     {"iterations", n_iters},
+                                     {"wall_time", timing.first},
+                                     {"comm_time", timing.second},
+                                     {"comm_share", timing.second / timing.first},
+                                     {"commit", commit ? commit : ""}};
+            fh << record.dump() << std::endl;
+            fmt::print("{} {} procs={} threads={} : {:.3f}s (comm {:.1f}%)\n", name, mode, n_procs, n_threads,
+                       timing.first, 100.0 * timing.second / timing.first);
+        }
+        fh.close();
+    }
+
+    MPI_Finalize();
+    return 0;
+}
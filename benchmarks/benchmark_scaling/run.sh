@@ -0,0 +1,17 @@
+#!/usr/bin/env bash
+# usage: run.sh <max_threads> <max_procs>
+# strong scaling keeps the total number of particles fixed
+# weak scaling keeps the number of particles per core fixed
+max_threads=${1:-4}
+max_procs=${2:-1}
+output=../result/scaling.jsonl
+
+rm -f ${output}
+for mode in strong weak; do
+    for ((n_procs = 1 ; n_procs <= $max_procs ; n_procs=n_procs*2)); do
+        for ((n_threads = 1 ; n_threads <= $max_threads ; n_threads=n_threads*2)); do
+            mpirun --use-hwthread-cpus -np ${n_procs} --map-by node:PE=${n_threads} ./app ${mode} ${n_threads} ${output}
+        done
+    done
+done
+python3 ../../../tools/scaling_report.py ${output} > ../result/scaling.txt
@@ -81,6 +81,154 @@ public:
     }
 };
 
+/**
+ * @brief base class for static activation functions
+ * 
+ * Static activations have no virtual calls, they are applied in place on whole
+ * Eigen matrices so the element-wise ones compile to vectorized loops.
+ * Rows of a matrix are samples.
+ */
+template<typename T_derived>
+class static_activation{
+public:
+    /**
+     * @brief vector-wise activation
+     * the buffer is treated as a single sample
+     * 
+     * @param mem_in_ptr 
+     * @param mem_out_ptr 
+     * @param size 
+     * @return * void 
+     */
+    template<typename T_e>
+    void operator()(T_e* mem_in_ptr, T_e* mem_out_ptr, int size) const{
+        Eigen::Map<Eigen::Matrix<T_e, 1, Eigen::Dynamic>> out(mem_out_ptr, size);
+        if(mem_out_ptr != mem_in_ptr)
+            out = Eigen::Map<Eigen::Matrix<T_e, 1, Eigen::Dynamic>>(mem_in_ptr, size);
+        T_derived::apply(out);
+    }
+    /**
+     * @brief inplace vector-wise activation
+     * 
+     * @param mem_inout_ptr 
+     * @param size 
+     * @return * void 
+     */
+    template<typename T_e>
+    void operator()(T_e* mem_inout_ptr, int size) const{
+        (*this)(mem_inout_ptr, mem_inout_ptr, size);
+    }
+};
+
+/**
+ * @brief base class for static element-wise activation functions
+ * derived classes define `eval` on Eigen arrays
+ * 
+ */
+template<typename T_derived>
+class static_elm_activation: public static_activation<T_derived>{
+public:
+    static constexpr bool elementwise = true;
+    /**
+     * @brief inplace activation of a matrix
+     * 
+     * @param m an Eigen matrix or map
+     * @return * void 
+     */
+    template<typename T_matrix>
+    static void apply(T_matrix&& m){
+        m.array() = T_derived::eval(m.array());
+    }
+};
+
+// identity, the default activation of layers
+class identity: public static_elm_activation<identity>{
+public:
+    template<typename T_array>
+    static auto eval(const T_array& x){
+        return x;
+    }
+    template<typename T_matrix>
+    static void apply(T_matrix&& m){}
+};
+
+// step function without virtual calls
+class unit_step: public static_elm_activation<unit_step>{
+public:
+    template<typename T_array>
+    static auto eval(const T_array& x){
+        typedef typename T_array::Scalar T_e;
+        return (x >= T_e(0.0)).template cast<T_e>();
+    }
+};
+
+class relu: public static_elm_activation<relu>{
+public:
+    template<typename T_array>
+    static auto eval(const T_array& x){
+        typedef typename T_array::Scalar T_e;
+        return x.max(T_e(0.0));
+    }
+};
+
+/**
+ * @brief leaky relu with the slope T_num / T_den for negative inputs
+ * 
+ */
+template<int T_num=1, int T_den=100>
+class leaky_relu: public static_elm_activation<leaky_relu<T_num, T_den>>{
+public:
+    template<typename T_array>
+    static auto eval(const T_array& x){
+        typedef typename T_array::Scalar T_e;
+        return x.max(x * T_e(T_num) / T_e(T_den));
+    }
+};
+
+class tanh: public static_elm_activation<tanh>{
+public:
+    template<typename T_array>
+    static auto eval(const T_array& x){
+        return x.tanh();
+    }
+};
+
+class sigmoid: public static_elm_activation<sigmoid>{
+public:
+    template<typename T_array>
+    static auto eval(const T_array& x){
+        typedef typename T_array::Scalar T_e;
+        return ((-x).exp() + T_e(1.0)).inverse();
+    }
+};
+
+// gelu with the tanh approximation
+class gelu: public static_elm_activation<gelu>{
+public:
+    template<typename T_array>
+    static auto eval(const T_array& x){
+        typedef typename T_array::Scalar T_e;
+        // sqrt(2 / pi)
+        const T_e c = T_e(0.7978845608028654);
+        return T_e(0.5) * x * ((c * (x + T_e(0.044715) * x.cube())).tanh() + T_e(1.0));
+    }
+};
+
+// row-wise softmax, each row is a sample
+class softmax: public static_activation<softmax>{
+public:
+    static constexpr bool elementwise = false;
+    template<typename T_matrix>
+    static void apply(T_matrix&& m){
+        for(int r=0; r<m.rows(); r++){
+            auto row = m.row(r).array();
+            // shift by the maximum for numerical stability
+            row = (row - row.maxCoeff()).exp();
+            row /= row.sum();
+        }
+    }
+};
+
 };
 
 };
@@ -1,2 +1,9 @@
+#include <rocky/etna/matrix.h>
 #include <rocky/etna/activation.h>
-#include <rocky/etna/linear.h>
\ No newline at end of file
+#include <rocky/etna/workspace.h>
+#include <rocky/etna/linear.h>
+#include <rocky/etna/dynamic.h>
+#include <rocky/etna/normalization.h>
+#include <rocky/etna/sequential.h>
+#include <rocky/etna/loss.h>
+#include <rocky/etna/quantized.h>
\ No newline at end of file
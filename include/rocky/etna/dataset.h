@@ -0,0 +1,265 @@
+#ifndef ROCKY_ETNA_DATASET
+#define ROCKY_ETNA_DATASET
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <Eigen/Core>
+#include <rocky/etna/matrix.h>
+
+namespace rocky{
+namespace etna{
+
+/**
+ * @brief a view of a row-major dataset, the caller owns the memory
+ *
+ */
+template<typename T_e>
+struct dataset_view{
+    // n_rows x in_dim inputs
+    T_e* inputs;
+    // n_rows x out_dim targets
+    T_e* targets;
+    // number of samples
+    long n_rows;
+    // dimension of a sample
+    int in_dim;
+    // dimension of a target
+    int out_dim;
+};
+
+/**
+ * @brief header of the binary dataset format
+ *
+ * The header is followed by the row-major inputs and then by the row-major
+ * targets, both blocks start at a multiple of 64 bytes.
+ */
+struct dataset_header{
+    char magic[8];
+    std::int64_t n_rows;
+    std::int32_t in_dim;
+    std::int32_t out_dim;
+    // size of an element in bytes, 4 or 8
+    std::int32_t element_size;
+    std::int32_t reserved[9];
+
+    static constexpr const char* expected_magic = "ROCKYDS1";
+    static constexpr std::int64_t alignment = 64;
+
+    static std::int64_t align(std::int64_t offset){
+        return ((offset + alignment - 1) / alignment) * alignment;
+    }
+    std::int64_t inputs_offset() const{
+        return align(sizeof(dataset_header));
+    }
+    std::int64_t targets_offset() const{
+        return align(inputs_offset() + n_rows * in_dim * element_size);
+    }
+    std::int64_t file_size() const{
+        return targets_offset() + n_rows * out_dim * element_size;
+    }
+};
+
+/**
+ * @brief a read-only memory-mapped dataset in the binary format
+ *
+ * The file is mapped with MAP_SHARED, so all processes on a host that map the
+ * same file, e.g. MPI ranks, share a single copy in the page cache and only
+ * the pages that are touched are read from the disk.
+ */
+template<typename T_e>
+class mapped_dataset{
+public:
+    typedef Eigen::Map<const row_matrix<T_e, Eigen::Dynamic, Eigen::Dynamic>> const_view_type;
+
+protected:
+    void* mem_ = MAP_FAILED;
+    size_t size_ = 0;
+    dataset_header header_;
+
+public:
+    /**
+     * @param path binary dataset, see convert_csv
+     */
+    explicit mapped_dataset(const std::string& path){
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            throw std::runtime_error("cannot open dataset " + path + " : " + std::strerror(errno));
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(dataset_header))){
+            ::close(fd);
+            throw std::runtime_error("invalid dataset " + path);
+        }
+        size_ = st.st_size;
+        mem_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(mem_ == MAP_FAILED)
+            throw std::runtime_error("cannot map dataset " + path + " : " + std::strerror(errno));
+        std::memcpy(&header_, mem_, sizeof(dataset_header));
+        if(std::memcmp(header_.magic, dataset_header::expected_magic, 8) != 0 || header_.file_size() > static_cast<std::int64_t>(size_)){
+            munmap(mem_, size_);
+            throw std::runtime_error("invalid dataset " + path);
+        }
+        if(header_.element_size != sizeof(T_e)){
+            munmap(mem_, size_);
+            throw std::runtime_error("dataset " + path + " has " + std::to_string(header_.element_size) + "-byte elements");
+        }
+    }
+    mapped_dataset(const mapped_dataset&) = delete;
+    mapped_dataset& operator=(const mapped_dataset&) = delete;
+    ~mapped_dataset(){
+        if(mem_ != MAP_FAILED)
+            munmap(mem_, size_);
+    }
+    long n_rows() const{
+        return header_.n_rows;
+    }
+    int in_dim() const{
+        return header_.in_dim;
+    }
+    int out_dim() const{
+        return header_.out_dim;
+    }
+    const T_e* inputs() const{
+        return reinterpret_cast<const T_e*>(static_cast<const char*>(mem_) + header_.inputs_offset());
+    }
+    const T_e* targets() const{
+        return reinterpret_cast<const T_e*>(static_cast<const char*>(mem_) + header_.targets_offset());
+    }
+    /**
+     * @brief zero-copy view of the inputs of consecutive samples
+     *
+     * @param first first sample
+     * @param n number of samples
+     * @return const_view_type
+     */
+    const_view_type inputs(long first, long n) const{
+        return const_view_type(inputs() + first * in_dim(), n, in_dim());
+    }
+    // zero-copy view of the targets of consecutive samples
+    const_view_type targets(long first, long n) const{
+        return const_view_type(targets() + first * out_dim(), n, out_dim());
+    }
+    /**
+     * @brief the whole dataset as a dataset view
+     * the memory is read-only, consumers must not write to it
+     *
+     * @return dataset_view<T_e>
+     */
+    dataset_view<T_e> view() const{
+        return {const_cast<T_e*>(inputs()), const_cast<T_e*>(targets()), n_rows(), in_dim(), out_dim()};
+    }
+    /**
+     * @brief ask the kernel to read the pages of some samples ahead of time
+     *
+     * @param indices indices of the samples
+     * @param n number of samples
+     */
+    void prefetch(const long* indices, int n) const{
+        const long page = sysconf(_SC_PAGESIZE);
+        auto advise = [&](const T_e* ptr, long n_elements){
+            std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(ptr) / page * page;
+            std::uintptr_t end = reinterpret_cast<std::uintptr_t>(ptr + n_elements);
+            madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+        };
+        for(int i=0; i<n; i++){
+            advise(inputs() + indices[i] * in_dim(), in_dim());
+            advise(targets() + indices[i] * out_dim(), out_dim());
+        }
+    }
+};
+
+/**
+ * @brief convert a CSV file to the binary dataset format
+ * each line holds in_dim input values followed by out_dim target values
+ *
+ * @param csv_path source file
+ * @param binary_path destination file
+ * @param in_dim number of inputs
+ * @param out_dim number of targets
+ * @param skip_header skip the first line
+ * @return long number of converted samples
+ */
+template<typename T_e>
+long convert_csv(const std::string& csv_path, const std::string& binary_path, int in_dim, int out_dim, bool skip_header=false){
+    std::ifstream csv(csv_path);
+    if(!csv)
+        throw std::runtime_error("cannot open " + csv_path);
+    // the first pass counts the samples so the blocks can be placed
+    dataset_header header{};
+    std::memcpy(header.magic, dataset_header::expected_magic, 8);
+    header.in_dim = in_dim;
+    header.out_dim = out_dim;
+    header.element_size = sizeof(T_e);
+    std::string line;
+    if(skip_header)
+        std::getline(csv, line);
+    std::int64_t n_rows = 0;
+    while(std::getline(csv, line))
+        if(line.find_first_not_of(" \t\r") != std::string::npos)
+            n_rows++;
+    header.n_rows = n_rows;
+
+    int fd = ::open(binary_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0)
+        throw std::runtime_error("cannot create " + binary_path + " : " + std::strerror(errno));
+    const size_t size = header.file_size();
+    if(ftruncate(fd, size) != 0){
+        ::close(fd);
+        throw std::runtime_error("cannot resize " + binary_path + " : " + std::strerror(errno));
+    }
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mem == MAP_FAILED)
+        throw std::runtime_error("cannot map " + binary_path + " : " + std::strerror(errno));
+    std::memcpy(mem, &header, sizeof(dataset_header));
+    T_e* inputs = reinterpret_cast<T_e*>(static_cast<char*>(mem) + header.inputs_offset());
+    T_e* targets = reinterpret_cast<T_e*>(static_cast<char*>(mem) + header.targets_offset());
+
+    // the second pass parses the values
+    csv.clear();
+    csv.seekg(0);
+    if(skip_header)
+        std::getline(csv, line);
+    std::int64_t r = 0;
+    while(r < n_rows && std::getline(csv, line)){
+        if(line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+        const char* p = line.c_str();
+        char* end = nullptr;
+        for(int c=0; c<in_dim + out_dim; c++){
+            double value = std::strtod(p, &end);
+            if(end == p){
+                munmap(mem, size);
+                throw std::runtime_error(csv_path + " : line " + std::to_string(r + 1 + skip_header) + " has fewer than " + std::to_string(in_dim + out_dim) + " values");
+            }
+            if(c < in_dim)
+                inputs[r * in_dim + c] = value;
+            else
+                targets[r * out_dim + c - in_dim] = value;
+            p = end;
+            while(*p == ',' || *p == ' ' || *p == '\t')
+                p++;
+        }
+        r++;
+    }
+    msync(mem, size, MS_SYNC);
+    munmap(mem, size);
+    return n_rows;
+}
+
+};
+};
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef ROCKY_ETNA_DYNAMIC
+#define ROCKY_ETNA_DYNAMIC
+
+#include <Eigen/Core>
+#include <algorithm>
+#include <rocky/etna/workspace.h>
+#include <rocky/etna/matrix.h>
+#include <rocky/etna/activation.h>
+#include <rocky/etna/linear.h>
+
+namespace rocky{
+namespace etna{
+
+/**
+ * @brief a linear layer whose shape is given at runtime
+ * the parameters have the layout of linear, the weights followed by the bias
+ *
+ */
+template<typename T_e, typename T_act=act::identity>
+class dynamic_linear{
+public:
+    // number of samples multiplied at once, the block of outputs stays in cache for the bias and the activation
+    static constexpr int row_block = 256;
+
+protected:
+    int in_dim_;
+    int out_dim_;
+    opt opt_bias_;
+
+public:
+    dynamic_linear(int in_dim, int out_dim, opt opt_bias=opt::bias)
+    :in_dim_(in_dim), out_dim_(out_dim), opt_bias_(opt_bias){}
+    int in_dim() const{
+        return in_dim_;
+    }
+    int out_dim() const{
+        return out_dim_;
+    }
+    int num_params_weights() const{
+        return in_dim_ * out_dim_;
+    }
+    int num_params_bias() const{
+        return (opt_bias_ == opt::bias) ? out_dim_ : 0;
+    }
+    int num_params() const{
+        return num_params_weights() + num_params_bias();
+    }
+    /**
+     * (n_rows * in_dim) @ (in_dim x out_dim) -> (n_rows * out_dim)
+     * large products are computed by the blocked and packed kernel of Eigen
+     * **/
+    void feed(T_e* layer_mem_ptr, T_e* in_mem_ptr, T_e* out_mem_ptr, int n_rows) const{
+        typedef row_matrix<T_e, Eigen::Dynamic, Eigen::Dynamic> matrix_type;
+        Eigen::Map<matrix_type> W_(layer_mem_ptr, in_dim_, out_dim_);
+        Eigen::Map<row_matrix<T_e, 1, Eigen::Dynamic>> Bias_(layer_mem_ptr + num_params_weights(), 1, out_dim_);
+        for(int first=0; first<n_rows; first+=row_block){
+            const int rows = std::min(row_block, n_rows - first);
+            Eigen::Map<matrix_type> In_(in_mem_ptr + static_cast<long>(first) * in_dim_, rows, in_dim_);
+            Eigen::Map<matrix_type> Out_(out_mem_ptr + static_cast<long>(first) * out_dim_, rows, out_dim_);
+            Out_.noalias() = In_ * W_;
+            if(opt_bias_ == opt::bias){
+                if constexpr (T_act::elementwise)
+                    Out_.array() = T_act::eval((Out_.rowwise() + Bias_).array());
+                else{
+                    Out_.rowwise() += Bias_;
+                    T_act::apply(Out_);
+                }
+            }
+            else
+                T_act::apply(Out_);
+        }
+    }
+}; // end dynamic_linear
+
+/**
+ * @brief a multi-layer perceptron whose architecture and batch size are given at runtime
+ * the parameters have the layout of mlp with the same dimensions, so a solution
+ * can be evaluated by either model
+ *
+ */
+template<typename T_e, typename T_act=act::identity>
+class dynamic_mlp{
+protected:
+    int layers_num_;
+    int in_dim_;
+    int out_dim_;
+    int hidden_dim_;
+    opt opt_bias_;
+
+    // round a number of elements up to the workspace alignment
+    static long padded(long size){
+        constexpr long align = workspace<T_e>::alignment / sizeof(T_e);
+        return ((size + align - 1) / align) * align;
+    }
+
+public:
+    dynamic_mlp(int layers_num, int in_dim, int out_dim, int hidden_dim, opt opt_bias=opt::bias)
+    :layers_num_(layers_num), in_dim_(in_dim), out_dim_(out_dim), hidden_dim_(hidden_dim), opt_bias_(opt_bias){}
+    int in_dim() const{
+        return in_dim_;
+    }
+    int out_dim() const{
+        return out_dim_;
+    }
+    // input layer, hidden layers and output layer
+    int num_layers() const{
+        return layers_num_ + 2;
+    }
+    int layer_in_dim(int layer) const{
+        return (layer == 0) ? in_dim_ : hidden_dim_;
+    }
+    int layer_out_dim(int layer) const{
+        return (layer == layers_num_ + 1) ? out_dim_ : hidden_dim_;
+    }
+    int layer_num_params(int layer) const{
+        return layer_in_dim(layer) * layer_out_dim(layer) + ((opt_bias_ == opt::bias) ? layer_out_dim(layer) : 0);
+    }
+    /**
+     * @brief offset of the parameters of a layer
+     * the offset of layer num_layers() is the total number of parameters
+     */
+    int layer_offset(int layer) const{
+        int offset = 0;
+        for(int l=0; l<layer && l<num_layers(); l++)
+            offset += layer_num_params(l);
+        return offset;
+    }
+    int num_params() const{
+        return layer_offset(num_layers());
+    }
+    /**
+     * @brief number of scratch elements required by feed
+     * two buffers for the hidden activations, each padded to the workspace alignment
+     *
+     * @param n_rows number of samples
+     */
+    long workspace_size(int n_rows) const{
+        return 2 * padded(static_cast<long>(n_rows) * hidden_dim_);
+    }
+    /**
+     * @brief apply the multi-layer perceptron on `n_rows` samples in `in_mem_ptr`
+     * the scratch memory is taken from the workspace of the calling thread
+     *
+     * @param layer_mem_ptr memory block containing layer parameters
+     * @param in_mem_ptr memory block containing input data
+     * @param out_mem_ptr memory block for storing the result
+     * @param n_rows number of samples
+     * @return ** void
+     */
+    void feed(T_e* layer_mem_ptr, T_e* in_mem_ptr, T_e* out_mem_ptr, int n_rows) const{
+        feed(layer_mem_ptr, in_mem_ptr, out_mem_ptr, n_rows, workspace<T_e>::local().reserve(workspace_size(n_rows)));
+    }
+    /**
+     * @brief apply the multi-layer perceptron with caller-provided scratch memory
+     *
+     * @param layer_mem_ptr memory block containing layer parameters
+     * @param in_mem_ptr memory block containing input data
+     * @param out_mem_ptr memory block for storing the result
+     * @param n_rows number of samples
+     * @param ws_mem_ptr scratch memory with workspace_size(n_rows) elements
+     * @return ** void
+     */
+    void feed(T_e* layer_mem_ptr, T_e* in_mem_ptr, T_e* out_mem_ptr, int n_rows, T_e* ws_mem_ptr) const{
+        dynamic_linear<T_e, T_act> l_in(in_dim_, hidden_dim_, opt_bias_);
+        dynamic_linear<T_e, T_act> l_hidden(hidden_dim_, hidden_dim_, opt_bias_);
+        dynamic_linear<T_e> l_out(hidden_dim_, out_dim_, opt_bias_);
+        T_e* H1_ = ws_mem_ptr;
+        T_e* H2_ = ws_mem_ptr + workspace_size(n_rows) / 2;
+        // apply input layer
+        l_in.feed(layer_mem_ptr, in_mem_ptr, H1_, n_rows);
+        int offset = l_in.num_params();
+        // apply hidden layers
+        for(int hidden=0; hidden<layers_num_; hidden++){
+            l_hidden.feed(layer_mem_ptr + offset, H1_, H2_, n_rows);
+            std::swap(H1_, H2_);
+            offset += l_hidden.num_params();
+        }
+        // apply output layer
+        l_out.feed(layer_mem_ptr + offset, H1_, out_mem_ptr, n_rows);
+    }
+};
+
+};
+};
+
+#endif
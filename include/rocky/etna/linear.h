@@ -4,6 +4,9 @@
 #include <Eigen/Core>
 #include <type_traits>
 #include <algorithm>
+#include <rocky/etna/workspace.h>
+#include <rocky/etna/matrix.h>
+#include <rocky/etna/activation.h>
 
 namespace rocky{
 namespace etna{
@@ -11,10 +14,11 @@ enum opt {bias, no_bias};
 
 /**
  * @brief base class for static layers
+ * a static activation is applied on the output right after the product
  * 
  */
 template<typename T_e, int T_in_num, int T_in_dim, int T_out_dim,
-        opt T_opt_bias=opt::bias>
+        opt T_opt_bias=opt::bias, typename T_act=act::identity>
 class linear{
 public:
     static constexpr int deduce_num_params_weights(){
@@ -29,26 +33,45 @@ public:
     static constexpr int deduce_num_params(){
         return deduce_num_params_weights() + deduce_num_params_bias(); 
     }
+    static constexpr int deduce_in_size(){
+        return T_in_num * T_in_dim;
+    }
+    static constexpr int deduce_out_size(){
+        return T_in_num * T_out_dim;
+    }
     /**
      * (T_in_num * T_in_dim) @ (T_in_dim x T_out_dim) -> (T_in_num * T_out_dim)
      * **/ 
     void feed(T_e* layer_mem_ptr, T_e* in_mem_ptr, T_e* out_mem_ptr){
-        Eigen::Map<Eigen::Matrix<T_e, T_in_dim, T_out_dim, Eigen::RowMajor>> W_(layer_mem_ptr);
-        Eigen::Map<Eigen::Matrix<T_e, T_in_num, T_in_dim, Eigen::RowMajor>> In_(in_mem_ptr);
-        Eigen::Map<Eigen::Matrix<T_e, T_in_num, T_out_dim, Eigen::RowMajor>> Out_(out_mem_ptr);
+        Eigen::Map<row_matrix<T_e, T_in_dim, T_out_dim>> W_(layer_mem_ptr);
+        Eigen::Map<row_matrix<T_e, T_in_num, T_in_dim>> In_(in_mem_ptr);
+        Eigen::Map<row_matrix<T_e, T_in_num, T_out_dim>> Out_(out_mem_ptr);
         Out_ = In_ * W_;
         // adding bias to each row
         if constexpr (T_opt_bias == opt::bias){
-            Eigen::Map<Eigen::Matrix<T_e, 1, T_out_dim, Eigen::RowMajor>> Bias_(layer_mem_ptr + T_in_dim * T_out_dim);
-            Out_.rowwise() += Bias_; 
-        }   
+            Eigen::Map<row_matrix<T_e, 1, T_out_dim>> Bias_(layer_mem_ptr + T_in_dim * T_out_dim);
+            // element-wise activations are fused with the bias in a single pass
+            if constexpr (T_act::elementwise)
+                Out_.array() = T_act::eval((Out_.rowwise() + Bias_).array());
+            else{
+                Out_.rowwise() += Bias_;
+                T_act::apply(Out_);
+            }
+        }
+        else
+            T_act::apply(Out_);
     }
 }; // end linear
 
+/**
+ * @brief multi-layer perceptron
+ * the activation is applied on the outputs of the input and hidden layers
+ * 
+ */
 template<typename T_e, int T_layers_num,
          int T_in_num, int T_in_dim,
          int T_out_dim, int T_hidden_dim,
-         opt T_opt_bias=opt::bias>
+         opt T_opt_bias=opt::bias, typename T_act=act::identity>
 class mlp{
 public:
     static constexpr int deduce_num_params_in(){
@@ -63,8 +86,65 @@ public:
     static constexpr int deduce_num_params(){
         return T_layers_num * deduce_num_params_hidden() + deduce_num_params_in() + deduce_num_params_out();
     }
+    static constexpr int deduce_batch_size(){
+        return T_in_num;
+    }
+    static constexpr int deduce_in_dim(){
+        return T_in_dim;
+    }
+    static constexpr int deduce_out_dim(){
+        return T_out_dim;
+    }
+    // input layer, hidden layers and output layer
+    static constexpr int deduce_num_layers(){
+        return T_layers_num + 2;
+    }
+    static constexpr int deduce_layer_in_dim(int layer){
+        return (layer == 0) ? T_in_dim : T_hidden_dim;
+    }
+    static constexpr int deduce_layer_out_dim(int layer){
+        return (layer == T_layers_num + 1) ? T_out_dim : T_hidden_dim;
+    }
+    /**
+     * @brief offset of the parameters of a layer
+     * the offset of layer deduce_num_layers() is the total number of parameters
+     */
+    static constexpr int deduce_layer_offset(int layer){
+        if(layer == 0)
+            return 0;
+        if(layer <= T_layers_num + 1)
+            return deduce_num_params_in() + (layer - 1) * deduce_num_params_hidden();
+        return deduce_num_params();
+    }
+    static constexpr int deduce_in_size(){
+        return T_in_num * T_in_dim;
+    }
+    static constexpr int deduce_out_size(){
+        return T_in_num * T_out_dim;
+    }
+    /**
+     * @brief number of scratch elements required by feed
+     * two buffers for the hidden activations, each padded to the workspace alignment
+     */
+    static constexpr int deduce_workspace_size(){
+        return 2 * padded(T_in_num * T_hidden_dim);
+    }
+    // number of networks whose input layers are computed by a single product in feed_population
+    static constexpr int population_tile = 8;
+    /**
+     * @brief number of scratch elements required by feed_population
+     * packed input weights and hidden activations of a tile, the buffers of feed
+     * and the dequantized parameters of a hidden or output layer
+     */
+    static constexpr int deduce_population_workspace_size(){
+        return padded(T_in_dim * population_tile * T_hidden_dim)
+             + padded(T_in_num * population_tile * T_hidden_dim)
+             + deduce_workspace_size()
+             + padded(std::max(deduce_num_params_hidden(), deduce_num_params_out()));
+    }
     /**
      * @brief apply the multi-layer perceptron on data in `in_mem_ptr`
+     * the scratch memory is taken from the workspace of the calling thread
      * 
      * @param layer_mem_ptr memory block containing layer parameters
      * @param in_mem_ptr  memory block containing input data
@@ -73,18 +153,192 @@ public:
      * 
      */
     void feed(T_e* layer_mem_ptr, T_e* in_mem_ptr, T_e* out_mem_ptr){
-        // layers
-        linear<T_e, T_in_num, T_in_dim, T_hidden_dim, T_opt_bias> l_in;
-        linear<T_e, T_in_num, T_hidden_dim, T_hidden_dim, T_opt_bias> l_hidden;
-        linear<T_e, T_in_num, T_hidden_dim, T_out_dim, T_opt_bias> l_out;
-        // reserving space for intermediate matrices
-        T_e* H1_ = new T_e[T_in_num * T_hidden_dim];
-        T_e* H2_ = new T_e[T_in_num * T_hidden_dim];
+        feed(layer_mem_ptr, in_mem_ptr, out_mem_ptr, workspace<T_e>::local().reserve(deduce_workspace_size()));
+    }
+    /**
+     * @brief apply the multi-layer perceptron with caller-provided scratch memory
+     * 
+     * @param layer_mem_ptr memory block containing layer parameters
+     * @param in_mem_ptr  memory block containing input data
+     * @param out_mem_ptr memory block for storing the result
+     * @param ws_mem_ptr scratch memory with deduce_workspace_size() elements
+     * @return ** void 
+     * 
+     */
+    void feed(T_e* layer_mem_ptr, T_e* in_mem_ptr, T_e* out_mem_ptr, T_e* ws_mem_ptr){
+        linear<T_e, T_in_num, T_in_dim, T_hidden_dim, T_opt_bias, T_act> l_in;
         // apply input layer
-        l_in.feed(layer_mem_ptr, in_mem_ptr, H1_);
+        l_in.feed(layer_mem_ptr, in_mem_ptr, ws_mem_ptr);
+        feed_hidden(layer_mem_ptr, ws_mem_ptr, out_mem_ptr);
+    }
+    /**
+     * @brief apply a population of multi-layer perceptrons on the same input
+     * the input layers of a tile of networks are applied by a single matrix product,
+     * so the input block is read once per tile instead of once per network
+     * 
+     * @param layer_mem_ptrs parameters of each network, e.g. particles of a solution container
+     * @param n number of networks
+     * @param in_mem_ptr memory block containing input data
+     * @param out_mem_ptrs memory blocks for storing the result of each network
+     * @param ws_mem_ptr scratch memory with deduce_population_workspace_size() elements
+     * @return ** void 
+     */
+    void feed_population(T_e** layer_mem_ptrs, int n, T_e* in_mem_ptr, T_e** out_mem_ptrs, T_e* ws_mem_ptr){
+        typedef row_matrix<T_e, Eigen::Dynamic, Eigen::Dynamic> matrix_type;
+        constexpr int tile_cols = population_tile * T_hidden_dim;
+        T_e* W_mem = ws_mem_ptr;
+        T_e* H_mem = W_mem + padded(T_in_dim * tile_cols);
+        T_e* feed_mem = H_mem + padded(T_in_num * tile_cols);
+        Eigen::Map<row_matrix<T_e, T_in_num, T_in_dim>> In_(in_mem_ptr);
+        for(int first=0; first<n; first+=population_tile){
+            const int n_tile = std::min(population_tile, n - first);
+            const int cols = n_tile * T_hidden_dim;
+            // pack the input weights of the tile side by side
+            Eigen::Map<matrix_type> W_(W_mem, T_in_dim, cols);
+            for(int p=0; p<n_tile; p++)
+                W_.middleCols(p * T_hidden_dim, T_hidden_dim) = Eigen::Map<row_matrix<T_e, T_in_dim, T_hidden_dim>>(layer_mem_ptrs[first + p]);
+            Eigen::Map<matrix_type> H_(H_mem, T_in_num, cols);
+            H_.noalias() = In_ * W_;
+            for(int p=0; p<n_tile; p++){
+                Eigen::Map<row_matrix<T_e, T_in_num, T_hidden_dim>> H1_(feed_mem);
+                H1_ = H_.middleCols(p * T_hidden_dim, T_hidden_dim);
+                if constexpr (T_opt_bias == opt::bias){
+                    Eigen::Map<row_matrix<T_e, 1, T_hidden_dim>> Bias_(layer_mem_ptrs[first + p] + T_in_dim * T_hidden_dim);
+                    H1_.rowwise() += Bias_;
+                }
+                T_act::apply(H1_);
+                feed_hidden(layer_mem_ptrs[first + p], feed_mem, out_mem_ptrs[first + p]);
+            }
+        }
+    }
+    /**
+     * @brief apply a population of multi-layer perceptrons with reduced-precision parameters
+     * the parameters are dequantized as they are used, the input weights while they are
+     * packed for the product of the tile and the other layers one at a time into a
+     * buffer of the workspace. so each call reads only the quantized parameters
+     * 
+     * @param layer_mem_ptrs quantized parameters of each network, in the layout of the model
+     * @param scale_ptrs scales of each network, one per layer, a parameter is its quantized value times the scale
+     * @param n number of networks
+     * @param in_mem_ptr memory block containing input data
+     * @param out_mem_ptrs memory blocks for storing the result of each network
+     * @param ws_mem_ptr scratch memory with deduce_population_workspace_size() elements
+     * @return ** void 
+     */
+    template<typename T_q>
+    void feed_population(const T_q* const* layer_mem_ptrs, const T_e* const* scale_ptrs, int n, T_e* in_mem_ptr, T_e** out_mem_ptrs, T_e* ws_mem_ptr){
+        typedef row_matrix<T_e, Eigen::Dynamic, Eigen::Dynamic> matrix_type;
+        constexpr int tile_cols = population_tile * T_hidden_dim;
+        T_e* W_mem = ws_mem_ptr;
+        T_e* H_mem = W_mem + padded(T_in_dim * tile_cols);
+        T_e* feed_mem = H_mem + padded(T_in_num * tile_cols);
+        T_e* layer_mem = feed_mem + deduce_workspace_size();
+        Eigen::Map<row_matrix<T_e, T_in_num, T_in_dim>> In_(in_mem_ptr);
+        for(int first=0; first<n; first+=population_tile){
+            const int n_tile = std::min(population_tile, n - first);
+            const int cols = n_tile * T_hidden_dim;
+            // dequantize the input weights of the tile while packing them side by side
+            Eigen::Map<matrix_type> W_(W_mem, T_in_dim, cols);
+            for(int p=0; p<n_tile; p++)
+                W_.middleCols(p * T_hidden_dim, T_hidden_dim) = Eigen::Map<const row_matrix<T_q, T_in_dim, T_hidden_dim>>(layer_mem_ptrs[first + p]).template cast<T_e>() * scale_ptrs[first + p][0];
+            Eigen::Map<matrix_type> H_(H_mem, T_in_num, cols);
+            H_.noalias() = In_ * W_;
+            for(int p=0; p<n_tile; p++){
+                const T_q* q_mem = layer_mem_ptrs[first + p];
+                const T_e* scales = scale_ptrs[first + p];
+                Eigen::Map<row_matrix<T_e, T_in_num, T_hidden_dim>> H1_(feed_mem);
+                H1_ = H_.middleCols(p * T_hidden_dim, T_hidden_dim);
+                if constexpr (T_opt_bias == opt::bias)
+                    H1_.rowwise() += Eigen::Map<const row_matrix<T_q, 1, T_hidden_dim>>(q_mem + T_in_dim * T_hidden_dim).template cast<T_e>() * scales[0];
+                T_act::apply(H1_);
+                // hidden and output layers from a dequantized copy of one layer at a time
+                linear<T_e, T_in_num, T_hidden_dim, T_hidden_dim, T_opt_bias, T_act> l_hidden;
+                linear<T_e, T_in_num, T_hidden_dim, T_out_dim, T_opt_bias> l_out;
+                T_e* buffers[2] = {feed_mem, feed_mem + deduce_workspace_size() / 2};
+                for(int layer=1; layer<=T_layers_num; layer++){
+                    dequantize_layer(q_mem, scales, layer, layer_mem);
+                    l_hidden.feed(layer_mem, buffers[(layer - 1) % 2], buffers[layer % 2]);
+                }
+                dequantize_layer(q_mem, scales, T_layers_num + 1, layer_mem);
+                l_out.feed(layer_mem, buffers[T_layers_num % 2], out_mem_ptrs[first + p]);
+            }
+        }
+    }
+    /**
+     * @brief apply the first `n_layers` layers, e.g. to cache the activations of layers that do not change
+     * 
+     * @param layer_mem_ptr memory block containing layer parameters
+     * @param in_mem_ptr memory block containing input data
+     * @param n_layers number of layers, from 1 to deduce_num_layers() - 1
+     * @param out_mem_ptr memory block for the activations of layer n_layers - 1, T_in_num x T_hidden_dim
+     * @param ws_mem_ptr scratch memory with deduce_workspace_size() elements
+     * @return ** void 
+     */
+    void feed_prefix(T_e* layer_mem_ptr, T_e* in_mem_ptr, int n_layers, T_e* out_mem_ptr, T_e* ws_mem_ptr){
+        linear<T_e, T_in_num, T_in_dim, T_hidden_dim, T_opt_bias, T_act> l_in;
+        linear<T_e, T_in_num, T_hidden_dim, T_hidden_dim, T_opt_bias, T_act> l_hidden;
+        T_e* buffers[2] = {ws_mem_ptr, ws_mem_ptr + deduce_workspace_size() / 2};
+        T_e* src = (n_layers == 1) ? out_mem_ptr : buffers[0];
+        l_in.feed(layer_mem_ptr, in_mem_ptr, src);
+        for(int layer=1; layer<n_layers; layer++){
+            T_e* dest = (layer == n_layers - 1) ? out_mem_ptr : buffers[layer % 2];
+            l_hidden.feed(layer_mem_ptr + deduce_layer_offset(layer), src, dest);
+            src = dest;
+        }
+    }
+    /**
+     * @brief apply the layers from `first_layer` on the activations of the previous layer
+     * feed_prefix followed by feed_suffix with the same split is equivalent to feed
+     * 
+     * @param layer_mem_ptr memory block containing layer parameters
+     * @param first_layer first layer to apply, from 1 to deduce_num_layers() - 1
+     * @param in_mem_ptr activations of layer first_layer - 1, T_in_num x T_hidden_dim
+     * @param out_mem_ptr memory block for storing the result
+     * @param ws_mem_ptr scratch memory with deduce_workspace_size() elements
+     * @return ** void 
+     */
+    void feed_suffix(T_e* layer_mem_ptr, int first_layer, T_e* in_mem_ptr, T_e* out_mem_ptr, T_e* ws_mem_ptr){
+        linear<T_e, T_in_num, T_hidden_dim, T_hidden_dim, T_opt_bias, T_act> l_hidden;
+        linear<T_e, T_in_num, T_hidden_dim, T_out_dim, T_opt_bias> l_out;
+        T_e* buffers[2] = {ws_mem_ptr, ws_mem_ptr + deduce_workspace_size() / 2};
+        T_e* src = in_mem_ptr;
+        for(int layer=first_layer; layer<=T_layers_num; layer++){
+            T_e* dest = buffers[layer % 2];
+            l_hidden.feed(layer_mem_ptr + deduce_layer_offset(layer), src, dest);
+            src = dest;
+        }
+        l_out.feed(layer_mem_ptr + deduce_layer_offset(T_layers_num + 1), src, out_mem_ptr);
+    }
+
+protected:
+    // round a number of elements up to the workspace alignment
+    static constexpr int padded(int size){
+        constexpr int align = workspace<T_e>::alignment / sizeof(T_e);
+        return ((size + align - 1) / align) * align;
+    }
+    // dequantize the parameters of a layer, a parameter is its quantized value times the scale of the layer
+    template<typename T_q>
+    static void dequantize_layer(const T_q* q_mem_ptr, const T_e* scales, int layer, T_e* layer_mem_ptr){
+        const int offset = deduce_layer_offset(layer);
+        const int size = deduce_layer_offset(layer + 1) - offset;
+        Eigen::Map<Eigen::Array<T_e, Eigen::Dynamic, 1>>(layer_mem_ptr, size) = Eigen::Map<const Eigen::Array<T_q, Eigen::Dynamic, 1>>(q_mem_ptr + offset, size).template cast<T_e>() * scales[layer];
+    }
+    /**
+     * @brief apply the hidden and output layers on the result of the input layer
+     * 
+     * @param layer_mem_ptr memory block containing layer parameters
+     * @param ws_mem_ptr scratch memory starting with the result of the input layer
+     * @param out_mem_ptr memory block for storing the result
+     */
+    void feed_hidden(T_e* layer_mem_ptr, T_e* ws_mem_ptr, T_e* out_mem_ptr){
+        linear<T_e, T_in_num, T_hidden_dim, T_hidden_dim, T_opt_bias, T_act> l_hidden;
+        linear<T_e, T_in_num, T_hidden_dim, T_out_dim, T_opt_bias> l_out;
+        // intermediate matrices
+        T_e* H1_ = ws_mem_ptr;
+        T_e* H2_ = ws_mem_ptr + deduce_workspace_size() / 2;
         // apply hidden layers
         T_e* src, *dest;
-        int offset = l_in.deduce_num_params();
+        int offset = deduce_num_params_in();
         for (int hidden=0; hidden<T_layers_num; hidden++){
             if (hidden % 2 == 0){ src = H1_; dest = H2_;}
             else{ src = H2_; dest = H1_;}
@@ -96,11 +350,7 @@ public:
             l_out.feed(layer_mem_ptr + offset, H1_, out_mem_ptr);
         else
             l_out.feed(layer_mem_ptr + offset, H2_, out_mem_ptr);
-        
-        delete[] H1_;
-        delete[] H2_;
     }
-
 };
 
 };
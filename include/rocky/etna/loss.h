@@ -0,0 +1,75 @@
+#ifndef ROCKY_ETNA_LOSS
+#define ROCKY_ETNA_LOSS
+
+#include <Eigen/Core>
+#include <rocky/etna/matrix.h>
+
+namespace rocky{
+namespace etna{
+namespace loss{
+
+/**
+ * @brief mean squared error
+ *
+ */
+class mse{
+public:
+    /**
+     * @brief sum of the squared errors of the first `n_rows` samples
+     *
+     * @param out_mem_ptr model output, T_rows x T_cols
+     * @param target_mem_ptr targets, at least n_rows x T_cols
+     * @param n_rows number of valid samples
+     * @return T_e
+     */
+    template<typename T_e, int T_rows, int T_cols>
+    static T_e sum(T_e* out_mem_ptr, T_e* target_mem_ptr, int n_rows){
+        Eigen::Map<row_matrix<T_e, T_rows, T_cols>> Out_(out_mem_ptr);
+        Eigen::Map<row_matrix<T_e, Eigen::Dynamic, T_cols>> Target_(target_mem_ptr, n_rows, T_cols);
+        return (Out_.topRows(n_rows) - Target_).squaredNorm();
+    }
+    // the mean is taken over all elements
+    static double count(long n_rows, int n_cols){
+        return static_cast<double>(n_rows) * n_cols;
+    }
+};
+
+/**
+ * @brief cross-entropy of the softmax of logits
+ * targets are class probabilities, e.g. one-hot rows. the softmax is never
+ * materialized, each row costs a log-sum-exp and a dot product
+ *
+ */
+class cross_entropy{
+public:
+    /**
+     * @brief sum of the cross-entropies of the first `n_rows` samples
+     *
+     * @param out_mem_ptr logits, T_rows x T_cols
+     * @param target_mem_ptr target probabilities, at least n_rows x T_cols
+     * @param n_rows number of valid samples
+     * @return T_e
+     */
+    template<typename T_e, int T_rows, int T_cols>
+    static T_e sum(T_e* out_mem_ptr, T_e* target_mem_ptr, int n_rows){
+        Eigen::Map<row_matrix<T_e, T_rows, T_cols>> Out_(out_mem_ptr);
+        Eigen::Map<row_matrix<T_e, Eigen::Dynamic, T_cols>> Target_(target_mem_ptr, n_rows, T_cols);
+        auto Z = Out_.topRows(n_rows).array();
+        auto T = Target_.array();
+        // log-sum-exp shifted by the maximum of each row
+        Eigen::Array<T_e, Eigen::Dynamic, 1> max_z = Z.rowwise().maxCoeff();
+        Eigen::Array<T_e, Eigen::Dynamic, 1> lse = max_z + (Z.colwise() - max_z).exp().rowwise().sum().log();
+        // sum_c t_c * (lse - z_c)
+        return (T.rowwise().sum() * lse).sum() - (T * Z).sum();
+    }
+    // the mean is taken over the samples
+    static double count(long n_rows, int n_cols){
+        return static_cast<double>(n_rows);
+    }
+};
+
+};
+};
+};
+
+#endif
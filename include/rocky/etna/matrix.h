@@ -0,0 +1,21 @@
+#ifndef ROCKY_ETNA_MATRIX
+#define ROCKY_ETNA_MATRIX
+
+#include <Eigen/Core>
+
+namespace rocky{
+namespace etna{
+
+/**
+ * @brief a fixed-size matrix type for row-major layer memory
+ * Eigen requires single-column matrices to be column-major,
+ * which has the same memory layout
+ */
+template<typename T_e, int T_rows, int T_cols>
+using row_matrix = Eigen::Matrix<T_e, T_rows, T_cols,
+                                 (T_cols == 1 && T_rows != 1) ? Eigen::ColMajor : Eigen::RowMajor>;
+
+};
+};
+
+#endif
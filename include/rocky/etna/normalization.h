@@ -0,0 +1,50 @@
+#ifndef ROCKY_ETNA_NORMALIZATION
+#define ROCKY_ETNA_NORMALIZATION
+
+#include <Eigen/Core>
+#include <rocky/etna/matrix.h>
+#include <rocky/etna/linear.h>
+
+namespace rocky{
+namespace etna{
+
+/**
+ * @brief layer normalization, each sample is scaled to zero mean and unit variance
+ * with opt::bias a learnable scale and shift of T_cols elements each follow
+ *
+ */
+template<typename T_e, int T_in_num, int T_dim, opt T_opt_affine=opt::bias>
+class layer_norm{
+public:
+    static constexpr int deduce_num_params(){
+        if constexpr(T_opt_affine == opt::bias)
+            return 2 * T_dim;
+        else
+            return 0;
+    }
+    static constexpr int deduce_in_size(){
+        return T_in_num * T_dim;
+    }
+    static constexpr int deduce_out_size(){
+        return T_in_num * T_dim;
+    }
+    void feed(T_e* layer_mem_ptr, T_e* in_mem_ptr, T_e* out_mem_ptr){
+        constexpr T_e epsilon = 1e-5;
+        Eigen::Map<row_matrix<T_e, T_in_num, T_dim>> In_(in_mem_ptr);
+        Eigen::Map<row_matrix<T_e, T_in_num, T_dim>> Out_(out_mem_ptr);
+        Eigen::Array<T_e, T_in_num, 1> mean = In_.array().rowwise().mean();
+        Out_.array() = In_.array().colwise() - mean;
+        Eigen::Array<T_e, T_in_num, 1> inv_std = (Out_.array().square().rowwise().mean() + epsilon).rsqrt();
+        Out_.array().colwise() *= inv_std;
+        if constexpr(T_opt_affine == opt::bias){
+            Eigen::Map<row_matrix<T_e, 1, T_dim>> Scale_(layer_mem_ptr);
+            Eigen::Map<row_matrix<T_e, 1, T_dim>> Shift_(layer_mem_ptr + T_dim);
+            Out_.array() = (Out_.array().rowwise() * Scale_.array()).rowwise() + Shift_.array();
+        }
+    }
+};
+
+};
+};
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef ROCKY_ETNA_SEQUENTIAL
+#define ROCKY_ETNA_SEQUENTIAL
+
+#include <Eigen/Core>
+#include <tuple>
+#include <array>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <rocky/etna/workspace.h>
+#include <rocky/etna/matrix.h>
+#include <rocky/etna/activation.h>
+
+namespace rocky{
+namespace etna{
+
+/**
+ * @brief a static activation as a layer without parameters
+ *
+ */
+template<typename T_e, int T_in_num, int T_dim, typename T_act>
+class activation_layer{
+public:
+    static constexpr int deduce_num_params(){
+        return 0;
+    }
+    static constexpr int deduce_in_size(){
+        return T_in_num * T_dim;
+    }
+    static constexpr int deduce_out_size(){
+        return T_in_num * T_dim;
+    }
+    void feed(T_e* layer_mem_ptr, T_e* in_mem_ptr, T_e* out_mem_ptr){
+        Eigen::Map<row_matrix<T_e, T_in_num, T_dim>> In_(in_mem_ptr);
+        Eigen::Map<row_matrix<T_e, T_in_num, T_dim>> Out_(out_mem_ptr);
+        if constexpr (T_act::elementwise)
+            Out_.array() = T_act::eval(In_.array());
+        else{
+            Out_ = In_;
+            T_act::apply(Out_);
+        }
+    }
+};
+
+namespace detail{
+// scratch memory required by a layer besides its input and output
+template<typename T_layer, typename = void>
+struct layer_workspace_size{
+    static constexpr int value = 0;
+};
+template<typename T_layer>
+struct layer_workspace_size<T_layer, std::void_t<decltype(T_layer::deduce_workspace_size())>>{
+    static constexpr int value = T_layer::deduce_workspace_size();
+};
+};
+
+/**
+ * @brief a model composed of layers applied one after another
+ *
+ * A layer provides deduce_num_params(), deduce_in_size(), deduce_out_size() and
+ * feed(layer_mem_ptr, in_mem_ptr, out_mem_ptr), e.g. linear, activation_layer,
+ * layer_norm, mlp or another sequential. The parameters of the layers are
+ * stored one after another. Parameter offsets and buffer sizes are computed at
+ * compile time and the intermediate results alternate between two buffers of
+ * the workspace, so a forward pass does not allocate.
+ *
+ */
+template<typename T_e, typename... T_layers>
+class sequential{
+    static_assert(sizeof...(T_layers) > 0, "sequential requires at least one layer");
+
+protected:
+    typedef std::tuple<T_layers...> layers_type;
+    static constexpr int n_layers_ = sizeof...(T_layers);
+    static constexpr std::array<int, n_layers_> num_params_ = {T_layers::deduce_num_params()...};
+    static constexpr std::array<int, n_layers_> in_sizes_ = {T_layers::deduce_in_size()...};
+    static constexpr std::array<int, n_layers_> out_sizes_ = {T_layers::deduce_out_size()...};
+    static constexpr std::array<int, n_layers_> workspace_sizes_ = {detail::layer_workspace_size<T_layers>::value...};
+
+    static constexpr bool shapes_match(){
+        for(int l=0; l+1<n_layers_; l++)
+            if(out_sizes_[l] != in_sizes_[l + 1])
+                return false;
+        return true;
+    }
+    static_assert(shapes_match(), "the output size of each layer must be the input size of the next layer");
+
+    layers_type layers_;
+
+    // round a number of elements up to the workspace alignment
+    static constexpr int padded(int size){
+        constexpr int align = workspace<T_e>::alignment / sizeof(T_e);
+        return ((size + align - 1) / align) * align;
+    }
+    static constexpr int deduce_nested_workspace_size(){
+        int size = 0;
+        for(int l=0; l<n_layers_; l++)
+            size = std::max(size, workspace_sizes_[l]);
+        return size;
+    }
+    template<int T_l>
+    void feed_layer(T_e* layer_mem_ptr, T_e* in_mem_ptr, T_e* out_mem_ptr, T_e* ws_mem_ptr){
+        T_e* buffers[2] = {ws_mem_ptr, ws_mem_ptr + padded(deduce_buffer_size())};
+        T_e* src = (T_l == 0) ? in_mem_ptr : buffers[(T_l - 1) % 2];
+        T_e* dest = (T_l == n_layers_ - 1) ? out_mem_ptr : buffers[T_l % 2];
+        auto& layer = std::get<T_l>(layers_);
+        if constexpr (workspace_sizes_[T_l] > 0)
+            layer.feed(layer_mem_ptr + deduce_layer_offset(T_l), src, dest, ws_mem_ptr + 2 * padded(deduce_buffer_size()));
+        else
+            layer.feed(layer_mem_ptr + deduce_layer_offset(T_l), src, dest);
+    }
+    template<int... T_ls>
+    void feed_layers(T_e* layer_mem_ptr, T_e* in_mem_ptr, T_e* out_mem_ptr, T_e* ws_mem_ptr, std::integer_sequence<int, T_ls...>){
+        (feed_layer<T_ls>(layer_mem_ptr, in_mem_ptr, out_mem_ptr, ws_mem_ptr), ...);
+    }
+
+public:
+    static constexpr int deduce_num_layers(){
+        return n_layers_;
+    }
+    static constexpr int deduce_num_params(){
+        return (T_layers::deduce_num_params() + ...);
+    }
+    /**
+     * @brief offset of the parameters of a layer
+     * the offset of layer deduce_num_layers() is the total number of parameters
+     */
+    static constexpr int deduce_layer_offset(int layer){
+        int offset = 0;
+        for(int l=0; l<layer && l<n_layers_; l++)
+            offset += num_params_[l];
+        return offset;
+    }
+    static constexpr int deduce_in_size(){
+        return in_sizes_[0];
+    }
+    static constexpr int deduce_out_size(){
+        return out_sizes_[n_layers_ - 1];
+    }
+    // the largest intermediate result
+    static constexpr int deduce_buffer_size(){
+        int size = 0;
+        for(int l=0; l+1<n_layers_; l++)
+            size = std::max(size, out_sizes_[l]);
+        return size;
+    }
+    /**
+     * @brief number of scratch elements required by feed
+     * two buffers for the intermediate results and the scratch memory of nested models
+     */
+    static constexpr int deduce_workspace_size(){
+        return 2 * padded(deduce_buffer_size()) + deduce_nested_workspace_size();
+    }
+    // a layer of the model
+    template<int T_l>
+    auto& layer(){
+        return std::get<T_l>(layers_);
+    }
+    /**
+     * @brief apply the layers on data in `in_mem_ptr`
+     * the scratch memory is taken from the workspace of the calling thread
+     *
+     * @param layer_mem_ptr memory block containing layer parameters
+     * @param in_mem_ptr  memory block containing input data
+     * @param out_mem_ptr memory block for storing the result
+     * @return ** void
+     */
+    void feed(T_e* layer_mem_ptr, T_e* in_mem_ptr, T_e* out_mem_ptr){
+        feed(layer_mem_ptr, in_mem_ptr, out_mem_ptr, workspace<T_e>::local().reserve(deduce_workspace_size()));
+    }
+    /**
+     * @brief apply the layers with caller-provided scratch memory
+     *
+     * @param layer_mem_ptr memory block containing layer parameters
+     * @param in_mem_ptr  memory block containing input data
+     * @param out_mem_ptr memory block for storing the result
+     * @param ws_mem_ptr scratch memory with deduce_workspace_size() elements
+     * @return ** void
+     */
+    void feed(T_e* layer_mem_ptr, T_e* in_mem_ptr, T_e* out_mem_ptr, T_e* ws_mem_ptr){
+        feed_layers(layer_mem_ptr, in_mem_ptr, out_mem_ptr, ws_mem_ptr, std::make_integer_sequence<int, n_layers_>{});
+    }
+};
+
+};
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef ROCKY_ETNA_WORKSPACE
+#define ROCKY_ETNA_WORKSPACE
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace rocky{
+namespace etna{
+
+/**
+ * @brief aligned scratch memory for the intermediate results of layers
+ *
+ * The buffer only grows, so after the first call with the largest model
+ * reserving scratch memory does not allocate.
+ */
+template<typename T_e>
+class workspace{
+public:
+    // alignment of the scratch memory in bytes, a cache line
+    static constexpr size_t alignment = 64;
+
+protected:
+    T_e* mem_ = nullptr;
+    size_t size_ = 0;
+
+public:
+    workspace() {}
+    explicit workspace(size_t size){
+        reserve(size);
+    }
+    workspace(const workspace&) = delete;
+    workspace& operator=(const workspace&) = delete;
+    ~workspace(){
+        std::free(mem_);
+    }
+    /**
+     * @brief get at least `size` elements of scratch memory
+     * the content is not preserved when the buffer grows
+     *
+     * @param size number of elements
+     * @return T_e* aligned memory
+     */
+    T_e* reserve(size_t size){
+        if(size <= size_)
+            return mem_;
+        // aligned_alloc requires a multiple of the alignment
+        size_t bytes = ((size * sizeof(T_e) + alignment - 1) / alignment) * alignment;
+        T_e* mem = static_cast<T_e*>(std::aligned_alloc(alignment, bytes));
+        if(mem == nullptr)
+            throw std::bad_alloc();
+        std::free(mem_);
+        mem_ = mem;
+        size_ = size;
+        return mem_;
+    }
+    size_t size() const{
+        return size_;
+    }
+    /**
+     * @brief the workspace of the calling thread
+     *
+     * @return workspace&
+     */
+    static workspace& local(){
+        static thread_local workspace ws;
+        return ws;
+    }
+};
+
+};
+};
+
+#endif
@@ -46,6 +46,32 @@ public:
         static std::uniform_real_distribution<T_e> dist(a, b);
         return dist(prng());
     }
+    /**
+     * @brief fill an array with standard normal variates
+     * uses the Box-Muller transform so that log, sqrt, sin and cos
+     * are evaluated with vectorized Eigen array kernels
+     *
+     * @param out destination array
+     * @param n number of variates
+     */
+    template<typename T_e>
+    static void normal(T_e* out, int n){
+        typedef Eigen::Array<T_e, Eigen::Dynamic, 1> array_type;
+        const int half = (n + 1) / 2;
+        std::uniform_real_distribution<T_e> dist(0.0, 1.0);
+        auto& gen = prng();
+        array_type u1(half), u2(half);
+        for(int i=0; i<half; ++i){
+            // 1 - u lies in (0, 1] which keeps the logarithm finite
+            u1[i] = 1.0 - dist(gen);
+            u2[i] = dist(gen);
+        }
+        const T_e two_pi = 2.0 * 3.14159265358979323846;
+        array_type radius = (-2.0 * u1.log()).sqrt();
+        u2 *= two_pi;
+        Eigen::Map<array_type>(out, half) = radius * u2.cos();
+        Eigen::Map<array_type>(out + half, n - half) = (radius * u2.sin()).head(n - half);
+    }
 };
 
 };
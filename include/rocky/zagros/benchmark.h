@@ -45,6 +45,19 @@ public:
             S += x[i] * x[i];
         return sqrt(S);
     }
+    virtual T_e objective_bounded(T_e* x, T_e threshold){
+        if(threshold < 0.0)
+            return objective(x);
+        // the partial sum of squares is compared with the squared threshold every 16 terms
+        T_e bound = threshold * threshold;
+        T_e S = 0.0;
+        for(int b=0; b<dim_ && S <= bound; b+=16){
+            int e = std::min(b + 16, dim_);
+            for(int i=b; i<e; i++)
+                S += x[i] * x[i];
+        }
+        return sqrt(S);
+    }
     virtual T_e lower_bound(){ return -10.0; }
     virtual T_e upper_bound(){ return 10.0; }
     virtual std::string to_string(){
@@ -104,6 +117,16 @@ public:
             S += (x[i]-shift_) * (x[i]-shift_) - 10.0*cos(2*M_PI * (x[i]-shift_));
         return S;
     }
+    virtual T_e objective_bounded(T_e* x, T_e threshold){
+        // same summation order as objective, every remaining term z^2 - 10cos(2 pi z) is at least -10
+        T_e S = 10.0 * dim_;
+        for(int b=0; b<dim_ && S - 10.0 * (dim_ - b) <= threshold; b+=16){
+            int e = std::min(b + 16, dim_);
+            for(int i=b; i<e; i++)
+                S += (x[i]-shift_) * (x[i]-shift_) - 10.0*cos(2*M_PI * (x[i]-shift_));
+        }
+        return S;
+    }
     virtual T_e lower_bound(){ return -5.12; }
     virtual T_e upper_bound(){ return 5.12; }
     virtual std::string to_string(){
@@ -308,6 +331,38 @@ public:
 
         return error;
     }
+    virtual T_e objective_bounded(T_e* x_, T_e threshold){
+        if(threshold < 0.0)
+            return objective(x_);
+        T_e* A_ = problem_.local().A_.data();
+        T_e* b_ = problem_.local().b_.data();
+
+        Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> A(A_, m_, n_);
+        Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, 1>> b(b_, m_);
+        Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, 1>> x(x_, n_);
+        // squared residuals are accumulated a block of rows at a time
+        const int block = 32;
+        T_e bound = threshold * threshold;
+        T_e S = 0.0;
+        for(int r=0; r<m_ && S <= bound; r+=block){
+            int rows = std::min(block, m_ - r);
+            S += (A.middleRows(r, rows) * x - b.segment(r, rows)).squaredNorm();
+        }
+        return sqrt(S);
+    }
+    // the residuals of the first rows estimate the error of all rows
+    virtual T_e objective_fidelity(T_e* x_, T_e fidelity){
+        int rows = std::clamp(static_cast<int>(std::ceil(fidelity * m_)), 1, m_);
+        if(rows == m_)
+            return objective(x_);
+        T_e* A_ = problem_.local().A_.data();
+        T_e* b_ = problem_.local().b_.data();
+
+        Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> A(A_, rows, n_);
+        Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, 1>> b(b_, rows);
+        Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, 1>> x(x_, n_);
+        return sqrt((A * x - b).squaredNorm() * m_ / rows);
+    }
     virtual T_e lower_bound(){ return -20.0; }
     virtual T_e upper_bound(){ return 20.0; }
 };
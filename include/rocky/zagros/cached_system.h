@@ -0,0 +1,264 @@
+/*
+    Copyright (C) 2022 Amirabbas Asadi , All Rights Reserved
+    distributed under Apache-2.0 license
+*/
+#ifndef ROCKY_ZAGROS_CACHED_SYSTEM_GUARD
+#define ROCKY_ZAGROS_CACHED_SYSTEM_GUARD
+#include<vector>
+#include<atomic>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<limits>
+#include<unordered_map>
+
+#include<tbb/spin_mutex.h>
+
+#include<rocky/zagros/system.h>
+
+namespace rocky{
+namespace zagros{
+
+/**
+ * @brief a memoization layer around the objective of a system
+ *
+ * Solutions are quantized and hashed with two independent 64-bit hashes, the
+ * first one selects a shard and the entry and the second one guards against
+ * collisions, so the table never stores solutions. Each shard is a bounded
+ * table protected by its own lock and evicts entries with the CLOCK policy.
+ */
+template<typename T_e>
+class cached_system: public system<T_e>{
+protected:
+    struct cache_key{
+        std::uint64_t primary;
+        std::uint64_t secondary;
+    };
+    struct cache_entry{
+        cache_key key;
+        T_e value;
+        bool referenced;
+    };
+    struct cache_shard{
+        tbb::spin_mutex mutex;
+        // primary hash to entry index
+        std::unordered_map<std::uint64_t, int> index;
+        std::vector<cache_entry> entries;
+        // position of the CLOCK hand
+        int hand = 0;
+    };
+
+    system<T_e>* main_system_;
+    int dim_;
+    // width of the quantization grid, zero uses the exact bits
+    T_e quantum_;
+    // maximum number of entries per shard
+    int shard_capacity_;
+    std::vector<cache_shard> shards_;
+    std::atomic<long> hits_{0};
+    std::atomic<long> misses_{0};
+
+    static std::uint64_t mix(std::uint64_t h, std::uint64_t word){
+        h ^= word + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+    cache_key make_key(const T_e* params){
+        cache_key key{0x243f6a8885a308d3ULL, 0x13198a2e03707344ULL};
+        for(int i=0; i<dim_; i++){
+            std::uint64_t word = 0;
+            if(quantum_ > 0.0){
+                word = static_cast<std::uint64_t>(std::llround(params[i] / quantum_));
+            }
+            else{
+                // +0 and -0 are the same solution
+                T_e x = (params[i] == 0.0) ? T_e(0.0) : params[i];
+                std::memcpy(&word, &x, sizeof(T_e));
+            }
+            key.primary = mix(key.primary, word);
+            key.secondary = mix(key.secondary, word ^ 0xa4093822299f31d0ULL);
+        }
+        return key;
+    }
+    cache_shard& shard(const cache_key& key){
+        return shards_[key.primary % shards_.size()];
+    }
+    bool lookup(const cache_key& key, T_e& value){
+        auto& s = shard(key);
+        tbb::spin_mutex::scoped_lock lock(s.mutex);
+        auto it = s.index.find(key.primary);
+        if(it == s.index.end() || s.entries[it->second].key.secondary != key.secondary)
+            return false;
+        s.entries[it->second].referenced = true;
+        value = s.entries[it->second].value;
+        return true;
+    }
+    void insert(const cache_key& key, T_e value){
+        auto& s = shard(key);
+        tbb::spin_mutex::scoped_lock lock(s.mutex);
+        auto it = s.index.find(key.primary);
+        if(it != s.index.end()){
+            s.entries[it->second] = {key, value, true};
+            return;
+        }
+        if(static_cast<int>(s.entries.size()) < shard_capacity_){
+            s.index[key.primary] = s.entries.size();
+            s.entries.push_back({key, value, false});
+            return;
+        }
+        // CLOCK: clear the reference bits until an unreferenced entry is found
+        while(s.entries[s.hand].referenced){
+            s.entries[s.hand].referenced = false;
+            s.hand = (s.hand + 1) % shard_capacity_;
+        }
+        s.index.erase(s.entries[s.hand].key.primary);
+        s.entries[s.hand] = {key, value, false};
+        s.index[key.primary] = s.hand;
+        s.hand = (s.hand + 1) % shard_capacity_;
+    }
+
+    /**
+     * @brief look up a batch and forward the misses to the wrapped system as one batch
+     * 
+     * @param thresholds acceptance thresholds, null for exact evaluations
+     */
+    void evaluate_batch(T_e** params, T_e* values, int n, const T_e* thresholds){
+        std::vector<cache_key> keys(n);
+        std::vector<char> found(n);
+        tbb::parallel_for(0, n, [&](int i){
+            keys[i] = this->make_key(params[i]);
+            found[i] = this->lookup(keys[i], values[i]);
+        });
+        std::vector<int> missed;
+        for(int i=0; i<n; i++)
+            if(!found[i])
+                missed.push_back(i);
+        hits_ += n - missed.size();
+        misses_ += missed.size();
+        if(missed.empty())
+            return;
+        std::vector<T_e*> missed_params(missed.size());
+        std::vector<T_e> missed_values(missed.size());
+        std::vector<T_e> missed_thresholds(missed.size(), std::numeric_limits<T_e>::max());
+        for(size_t i=0; i<missed.size(); i++){
+            missed_params[i] = params[missed[i]];
+            if(thresholds)
+                missed_thresholds[i] = thresholds[missed[i]];
+        }
+        if(thresholds)
+            main_system_->objective_batch_bounded(missed_params.data(), missed_values.data(), missed.size(), missed_thresholds.data());
+        else
+            main_system_->objective_batch(missed_params.data(), missed_values.data(), missed.size());
+        for(size_t i=0; i<missed.size(); i++){
+            values[missed[i]] = missed_values[i];
+            // values above the threshold may be partial
+            if(missed_values[i] <= missed_thresholds[i])
+                insert(keys[missed[i]], missed_values[i]);
+        }
+    }
+
+public:
+    /**
+     * @param main_system the wrapped system
+     * @param dim dimension of the solutions
+     * @param capacity maximum number of cached values
+     * @param quantum width of the quantization grid, solutions in the same cell share a value. zero only matches exact duplicates
+     * @param n_shards number of independently locked shards
+     */
+    cached_system(system<T_e>* main_system, int dim, int capacity=65536, T_e quantum=0.0, int n_shards=64)
+    :shards_(std::max(n_shards, 1)){
+        this->main_system_ = main_system;
+        this->dim_ = dim;
+        this->quantum_ = quantum;
+        this->shard_capacity_ = std::max(capacity / static_cast<int>(shards_.size()), 1);
+        for(auto& s: shards_){
+            s.index.reserve(shard_capacity_);
+            s.entries.reserve(shard_capacity_);
+        }
+    }
+    virtual T_e objective(T_e* params){
+        cache_key key = make_key(params);
+        T_e value;
+        if(lookup(key, value)){
+            hits_++;
+            return value;
+        }
+        misses_++;
+        value = main_system_->objective(params);
+        insert(key, value);
+        return value;
+    }
+    virtual T_e objective_bounded(T_e* params, T_e threshold){
+        cache_key key = make_key(params);
+        T_e value;
+        if(lookup(key, value)){
+            hits_++;
+            return value;
+        }
+        misses_++;
+        value = main_system_->objective_bounded(params, threshold);
+        // values above the threshold may be partial
+        if(value <= threshold)
+            insert(key, value);
+        return value;
+    }
+    virtual void objective_batch(T_e** params, T_e* values, int n){
+        evaluate_batch(params, values, n, nullptr);
+    }
+    // only full-fidelity values are cached
+    virtual T_e objective_fidelity(T_e* params, T_e fidelity){
+        if(fidelity >= 1.0)
+            return objective(params);
+        return main_system_->objective_fidelity(params, fidelity);
+    }
+    virtual void objective_batch_fidelity(T_e** params, T_e* values, int n, T_e fidelity){
+        if(fidelity >= 1.0)
+            evaluate_batch(params, values, n, nullptr);
+        else
+            main_system_->objective_batch_fidelity(params, values, n, fidelity);
+    }
+    virtual void objective_batch_bounded(T_e** params, T_e* values, int n, const T_e* thresholds){
+        evaluate_batch(params, values, n, thresholds);
+    }
+    // the misses of a batch are evaluated together
+    virtual bool batched(){
+        return main_system_->batched();
+    }
+    long hits() const{
+        return hits_;
+    }
+    long misses() const{
+        return misses_;
+    }
+    double hit_rate() const{
+        long total = hits_ + misses_;
+        return (total > 0) ? static_cast<double>(hits_) / total : 0.0;
+    }
+    // remove all cached values and reset the statistics
+    void clear(){
+        for(auto& s: shards_){
+            tbb::spin_mutex::scoped_lock lock(s.mutex);
+            s.index.clear();
+            s.entries.clear();
+            s.hand = 0;
+        }
+        hits_ = 0;
+        misses_ = 0;
+    }
+    virtual T_e lower_bound(){ return main_system_->lower_bound(); }
+    virtual T_e lower_bound(int p_index){ return main_system_->lower_bound(p_index); }
+    virtual T_e upper_bound(){ return main_system_->upper_bound(); }
+    virtual T_e upper_bound(int p_index){ return main_system_->upper_bound(p_index); }
+    virtual std::string to_string(){
+        return "cached " + main_system_->to_string();
+    }
+    virtual void optimize_for_block(int* block_mask, int block_dim){
+        main_system_->optimize_for_block(block_mask, block_dim);
+    }
+};
+
+}; // end of zagros namespace
+}; // end of rocky namespace
+#endif
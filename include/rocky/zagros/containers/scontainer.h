@@ -203,10 +203,30 @@ public:
       * @return * void 
       */
      void evaluate_and_update(system<T_e>* problem, int rng_start, int rng_end){
-        tbb::parallel_for(rng_start, rng_end, [&](int p){
-            T_e obj = problem->objective(this->particle(p));
-            this->values[p] = obj;        
-        });
+        if(rng_end <= rng_start)
+            return;
+        std::vector<T_e*> batch(rng_end - rng_start);
+        for(int p=rng_start; p<rng_end; p++)
+            batch[p - rng_start] = this->particle(p);
+        problem->objective_batch(batch.data(), this->values.data() + rng_start, rng_end - rng_start);
+     }
+     /**
+      * @brief evaluate the particles within a range with their acceptance thresholds
+      * evaluation of a particle can stop early once its value exceeds the threshold
+      * 
+      * @param problem a zagros system
+      * @param rng_start 
+      * @param rng_end 
+      * @param thresholds threshold of each particle in the range
+      * @return * void 
+      */
+     void evaluate_and_update_bounded(system<T_e>* problem, int rng_start, int rng_end, const T_e* thresholds){
+        if(rng_end <= rng_start)
+            return;
+        std::vector<T_e*> batch(rng_end - rng_start);
+        for(int p=rng_start; p<rng_end; p++)
+            batch[p - rng_start] = this->particle(p);
+        problem->objective_batch_bounded(batch.data(), this->values.data() + rng_start, rng_end - rng_start, thresholds);
      }
      /**
       * @brief evaluate and update a single particle
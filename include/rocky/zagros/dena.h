@@ -45,6 +45,10 @@ struct container_select_from_node: public container_node{
 struct container_eval_node: public container_node{
     std::string id;
 };
+struct container_eval_successive_halving_node: public container_eval_node{
+    float min_fidelity;
+    float eta;
+};
 
 struct init_node: public flow_node{};
 struct init_uniform_node: public init_node{
@@ -79,6 +83,23 @@ struct pso_step_node: public pso_node{
 struct pso_group_level_step_node: public pso_step_node{};
 struct pso_cluster_level_step_node: public pso_step_node{};
 
+struct cmaes_node: public flow_node{};
+struct cmaes_memory_create_node: public cmaes_node{
+    std::string memory_id;
+    std::string main_cnt_id;
+    int max_population;
+};
+struct cmaes_step_node: public cmaes_node{
+    std::string memory_id;
+    std::string main_cnt_id;
+    int restart;
+    float sigma;
+};
+struct cmaes_sep_step_node: public cmaes_step_node{};
+struct cmaes_lm_step_node: public cmaes_step_node{
+    int n_paths;
+};
+
 struct mutate_node: public flow_node{};
 struct mutate_gaussian_node: public mutate_node{
     std::string id;
@@ -97,6 +118,18 @@ struct crossover_differential_evolution_node: public crossover_node{
     float crossover_prob;
     float differential_weight;
 };
+struct de_node: public flow_node{};
+struct de_step_node: public de_node{
+    std::string id;
+    // mutation and adaptation schemes in the same order as zagros::de_mutation and zagros::de_adaptation
+    int mutation;
+    int adaptation;
+    float crossover_prob;
+    float differential_weight;
+    float p_best_rate;
+    float learning_rate;
+    int memory_size;
+};
 struct crossover_segment_node: public crossover_node{
     std::string id;
     int segment_length;
@@ -106,6 +139,24 @@ struct eda_node: public flow_node{};
 struct eda_mvn_node: public eda_node{};
 struct eda_mvn_fullcov_node: public eda_mvn_node{
     std::string id;
+    int n_candidates;
+};
+struct eda_mvn_diagonal_node: public eda_mvn_node{
+    std::string id;
+    int n_candidates;
+    int sample_size;
+};
+struct eda_mvn_lowrank_node: public eda_mvn_node{
+    std::string id;
+    int rank;
+    int n_candidates;
+    int sample_size;
+};
+struct eda_mvn_incremental_node: public eda_mvn_node{
+    std::string id;
+    int sample_size;
+    float learning_rate;
+    int refactor_period;
 };
 
 struct analysis_node: public flow_node{};
@@ -120,6 +171,14 @@ struct container_recorder_node: public analysis_node{
     container_analysis_handler* handler;
 };
 
+struct stochastic_node: public flow_node{};
+struct stochastic_minibatch_node: public stochastic_node{
+    std::string id;
+    int batch_size;
+    float growth;
+    int max_batch_size;
+};
+
 struct bcd_node: public flow_node{};
 enum bcd_mask_generator { uniform };
 struct bcd_mask_node: public bcd_node{
@@ -142,6 +201,10 @@ struct run_n_times_node: public run_node{
 struct run_every_n_steps_node: public run_node{
     int period;
 };
+struct run_steady_state_node: public run_node{
+    int n_evaluations;
+    int n_workers;
+};
 
 
 // a variant containing all nodes
@@ -154,19 +217,30 @@ typedef std::variant<log_local_best_node,
                     container_create_node,
                     container_select_from_node,
                     container_eval_node,
+                    container_eval_successive_halving_node,
                     pso_memory_create_node,
                     pso_group_level_step_node,
                     pso_cluster_level_step_node,
+                    cmaes_memory_create_node,
+                    cmaes_step_node,
+                    cmaes_sep_step_node,
+                    cmaes_lm_step_node,
                     mutate_gaussian_node,
                     crossover_multipoint_node,
                     crossover_differential_evolution_node,
+                    de_step_node,
                     crossover_segment_node,
                     eda_mvn_fullcov_node,
+                    eda_mvn_incremental_node,
+                    eda_mvn_diagonal_node,
+                    eda_mvn_lowrank_node,
                     plot_heatmap_node,
                     container_recorder_node,
+                    stochastic_minibatch_node,
                     run_with_probability_node,
                     run_n_times_node,
                     run_every_n_steps_node,
+                    run_steady_state_node,
                     run_until_no_improve_node> flow_node_variant;
 
 class node{
@@ -270,6 +344,26 @@ public:
         f.procedure.push_back(node_tag);
         return f;
     }
+    /**
+     * @brief evaluate all solutions in a container with successive halving
+     * solutions are evaluated at increasing fidelities and only the best 1/eta
+     * of each rung are promoted, the eliminated solutions get the maximum value
+     * 
+     * @param id target container
+     * @param min_fidelity fidelity of the first rung
+     * @param eta reduction factor between the rungs
+     * @return * flow 
+     */
+    static flow eval_successive_halving(std::string id, float min_fidelity=1.0/27.0, float eta=3.0){
+        flow f;
+        container_eval_successive_halving_node node;
+        node.id = id;
+        node.min_fidelity = min_fidelity;
+        node.eta = eta;
+        auto node_tag = node::register_node<>(node);
+        f.procedure.push_back(node_tag);
+        return f;
+    }
 };
 
 /**
@@ -400,6 +494,36 @@ static flow best(std::string id){
 }; // end of cluster
 }; // end of comm
 
+/**
+ * @brief factories for stochastic objectives
+ * 
+ */
+class stochastic{
+public:
+    /**
+     * @brief select a new mini-batch of samples for the objective
+     * all solutions are evaluated on the same mini-batch until the node runs again,
+     * the size of the mini-batch is multiplied by `growth` after each run
+     * 
+     * @param id container that is re-evaluated on the new mini-batch
+     * @param batch_size number of samples of the first mini-batch
+     * @param growth growth factor of the mini-batch size
+     * @param max_batch_size maximum number of samples, 0 for all samples
+     * @return * flow 
+     */
+    static flow minibatch(std::string id, int batch_size, float growth=1.0, int max_batch_size=0){
+        flow f;
+        stochastic_minibatch_node node;
+        node.id = id;
+        node.batch_size = batch_size;
+        node.growth = growth;
+        node.max_batch_size = max_batch_size;
+        auto node_tag = node::register_node<>(node);
+        f.procedure.push_back(node_tag);
+        return f;
+    }
+}; // end of stochastic
+
 /**
  * @brief factories for composable flows
  * 
@@ -454,6 +578,28 @@ public:
         f.procedure.push_back(node_tag);
         return f;
     }
+    /**
+     * @brief evaluate the candidates of the wrapped strategies asynchronously
+     * each finished evaluation immediately replaces the worst solution and a new candidate
+     * is generated from the current population, without any generational barrier.
+     * only mutation, segment crossover, differential evolution and full covariance or
+     * incremental EDA strategies can be wrapped
+     * 
+     * @param n_evaluations number of evaluations
+     * @param wrapped_flow 
+     * @param n_workers number of concurrent evaluations, 0 uses all threads
+     * @return * flow 
+     */
+    static flow steady_state(int n_evaluations, const flow& wrapped_flow, int n_workers=0){
+        flow f;
+        run_steady_state_node node;
+        node.n_evaluations = n_evaluations;
+        node.n_workers = n_workers;
+        node.sub_procedure.insert(node.sub_procedure.end(), wrapped_flow.procedure.begin(), wrapped_flow.procedure.end());
+        auto node_tag = node::register_node<>(node);
+        f.procedure.push_back(node_tag);
+        return f;
+    }
     /**
      * @brief run a flow until the best solution of a container does not improve
      * 
@@ -615,6 +761,110 @@ public:
 
 }; // end of pso
 
+/**
+ * @brief covariance matrix adaptation evolution strategy
+ * 
+ */
+class cmaes{
+public:
+    // restart policies, in the same order as zagros::cmaes_restart
+    enum restart {none, ipop, bipop};
+    /**
+     * @brief utilities for manipulating CMA-ES memory
+     * 
+     */
+    class memory{
+    public:
+        /**
+         * @brief creating a node for CMA-ES memory allocation
+         * 
+         * @param mem_id a unique name for refering to memory
+         * @param main_id target solution container
+         * @param max_population largest population size after restarts, 0 allows four doublings of the default size
+         * @return * flow 
+         */
+        static flow create(std::string mem_id, std::string main_id, int max_population=0){
+            flow f;
+            cmaes_memory_create_node node;
+            node.memory_id = mem_id;
+            node.main_cnt_id = main_id;
+            node.max_population = max_population;
+            auto node_tag = node::register_node<>(node);
+            f.procedure.push_back(node_tag);
+            return f;
+        }
+        /**
+         * @brief id of the population container
+         * 
+         * @param base memory id
+         * @return * std::string 
+         */
+        static std::string population(std::string base){
+            return base + std::string("__cmapop__");
+        }
+    }; // end of memory
+    /**
+     * @brief single generation of CMA-ES
+     * the best candidates of each generation replace the worst solutions of the main container
+     * 
+     * @param mem_id 
+     * @param main_id 
+     * @param policy restart policy
+     * @param sigma initial step size relative to the search range
+     * @return * flow 
+     */
+    static flow step(std::string mem_id, std::string main_id, restart policy=ipop, float sigma=0.3){
+        flow f;
+        cmaes_step_node node;
+        node.memory_id = mem_id;
+        node.main_cnt_id = main_id;
+        node.restart = policy;
+        node.sigma = sigma;
+        auto node_tag = node::register_node<>(node);
+        f.procedure.push_back(node_tag);
+        return f;
+    }
+    /**
+     * @brief separable CMA-ES with a diagonal covariance matrix
+     * time and memory per generation are linear in the dimension
+     * 
+     */
+    class sep{
+    public:
+        static flow step(std::string mem_id, std::string main_id, restart policy=ipop, float sigma=0.3){
+            flow f;
+            cmaes_sep_step_node node;
+            node.memory_id = mem_id;
+            node.main_cnt_id = main_id;
+            node.restart = policy;
+            node.sigma = sigma;
+            auto node_tag = node::register_node<>(node);
+            f.procedure.push_back(node_tag);
+            return f;
+        }
+    }; // end of sep
+    /**
+     * @brief limited-memory matrix adaptation evolution strategy
+     * the covariance is represented by `n_paths` evolution paths
+     * 
+     */
+    class lm{
+    public:
+        static flow step(std::string mem_id, std::string main_id, int n_paths=0, restart policy=ipop, float sigma=0.3){
+            flow f;
+            cmaes_lm_step_node node;
+            node.memory_id = mem_id;
+            node.main_cnt_id = main_id;
+            node.n_paths = n_paths;
+            node.restart = policy;
+            node.sigma = sigma;
+            auto node_tag = node::register_node<>(node);
+            f.procedure.push_back(node_tag);
+            return f;
+        }
+    }; // end of lm
+}; // end of cmaes
+
 class mutate{
 public:
     /**
@@ -688,6 +938,88 @@ public:
 
 }; // end of mutate
 
+/**
+ * @brief differential evolution engine with one-to-one selection
+ * 
+ */
+class de{
+protected:
+    static flow step(std::string id, int mutation, int adaptation, float cr, float dw, float p, float learning_rate, int memory_size){
+        flow f;
+        de_step_node node;
+        node.id = id;
+        node.mutation = mutation;
+        node.adaptation = adaptation;
+        node.crossover_prob = cr;
+        node.differential_weight = dw;
+        node.p_best_rate = p;
+        node.learning_rate = learning_rate;
+        node.memory_size = memory_size;
+        auto node_tag = node::register_node<>(node);
+        f.procedure.push_back(node_tag);
+        return f;
+    }
+public:
+    enum mutation {rand_1, best_1, current_to_pbest_1};
+    enum adaptation {fixed, jade_adaptation, shade_adaptation};
+    /**
+     * @brief DE/rand/1/bin
+     * 
+     * @param id target container
+     * @param cr crossover probability
+     * @param dw differential weight
+     * @return * flow 
+     */
+    static flow rand(std::string id, float cr=0.9, float dw=0.5){
+        return step(id, rand_1, fixed, cr, dw, 0.0, 0.0, 1);
+    }
+    /**
+     * @brief DE/best/1/bin
+     * 
+     * @param id target container
+     * @param cr crossover probability
+     * @param dw differential weight
+     * @return * flow 
+     */
+    static flow best(std::string id, float cr=0.9, float dw=0.5){
+        return step(id, best_1, fixed, cr, dw, 0.0, 0.0, 1);
+    }
+    /**
+     * @brief DE/current-to-pbest/1/bin
+     * 
+     * @param id target container
+     * @param cr crossover probability
+     * @param dw differential weight
+     * @param p fraction of the best solutions used as pbest
+     * @return * flow 
+     */
+    static flow current_to_pbest(std::string id, float cr=0.9, float dw=0.5, float p=0.1){
+        return step(id, current_to_pbest_1, fixed, cr, dw, p, 0.0, 1);
+    }
+    /**
+     * @brief JADE, current-to-pbest/1 with adaptive means of CR and F
+     * 
+     * @param id target container
+     * @param p fraction of the best solutions used as pbest
+     * @param c learning rate of the means
+     * @return * flow 
+     */
+    static flow jade(std::string id, float p=0.1, float c=0.1){
+        return step(id, current_to_pbest_1, jade_adaptation, 0.5, 0.5, p, c, 1);
+    }
+    /**
+     * @brief SHADE, current-to-pbest/1 with a success history of CR and F
+     * 
+     * @param id target container
+     * @param p fraction of the best solutions used as pbest
+     * @param memory_size number of entries in the success history
+     * @return * flow 
+     */
+    static flow shade(std::string id, float p=0.1, int memory_size=10){
+        return step(id, current_to_pbest_1, shade_adaptation, 0.5, 0.5, p, 0.0, memory_size);
+    }
+}; // end of de
+
 /**
  * @brief factories for estimation of distribution algorithms
  * 
@@ -703,13 +1035,74 @@ public:
      * @brief Multivariate Normal with Full Covariance Matrix
      * 
      * @param id target container
-     * @param sample_size number of samples to estimate covariance matrix
+     * @param n_candidates number of candidates generated in each step, 0 generates as many as the block size
      * @return * flow 
      */
-    static flow full_cov(std::string id){
+    static flow full_cov(std::string id, int n_candidates=0){
         flow f;
         eda_mvn_fullcov_node node;
         node.id = id;
+        node.n_candidates = n_candidates;
+        auto node_tag = node::register_node<>(node);
+        f.procedure.push_back(node_tag);
+        return f;
+    }
+    /**
+     * @brief Multivariate Normal with an exponentially smoothed covariance matrix
+     * the cholesky factor is updated incrementally and fully recomputed periodically
+     * 
+     * @param id target container
+     * @param learning_rate weight of the new top-k solutions in the smoothed mean and covariance
+     * @param refactor_period number of steps between two full cholesky factorizations
+     * @param sample_size number of top solutions used in each update, 0 selects a quarter of the container
+     * @return * flow 
+     */
+    static flow incremental(std::string id, float learning_rate=0.2, int refactor_period=50, int sample_size=0){
+        flow f;
+        eda_mvn_incremental_node node;
+        node.id = id;
+        node.learning_rate = learning_rate;
+        node.refactor_period = refactor_period;
+        node.sample_size = sample_size;
+        auto node_tag = node::register_node<>(node);
+        f.procedure.push_back(node_tag);
+        return f;
+    }
+    /**
+     * @brief Multivariate Normal with a diagonal covariance matrix
+     * memory and time per step are linear in the dimension
+     * 
+     * @param id target container
+     * @param n_candidates number of candidates generated in each step, 0 generates as many as the container size
+     * @param sample_size number of top solutions used for estimating the distribution, 0 selects half of the container
+     * @return * flow 
+     */
+    static flow diagonal(std::string id, int n_candidates=0, int sample_size=0){
+        flow f;
+        eda_mvn_diagonal_node node;
+        node.id = id;
+        node.n_candidates = n_candidates;
+        node.sample_size = sample_size;
+        auto node_tag = node::register_node<>(node);
+        f.procedure.push_back(node_tag);
+        return f;
+    }
+    /**
+     * @brief Multivariate Normal with a diagonal plus rank-k covariance matrix
+     * 
+     * @param id target container
+     * @param rank number of principal directions in the low-rank factor
+     * @param n_candidates number of candidates generated in each step, 0 generates as many as the container size
+     * @param sample_size number of top solutions used for estimating the distribution, 0 selects half of the container
+     * @return * flow 
+     */
+    static flow low_rank(std::string id, int rank, int n_candidates=0, int sample_size=0){
+        flow f;
+        eda_mvn_lowrank_node node;
+        node.id = id;
+        node.rank = rank;
+        node.n_candidates = n_candidates;
+        node.sample_size = sample_size;
         auto node_tag = node::register_node<>(node);
         f.procedure.push_back(node_tag);
         return f;
@@ -0,0 +1,459 @@
+/*
+    Copyright (C) 2022 Amirabbas Asadi , All Rights Reserved
+    distributed under Apache-2.0 license
+*/
+#ifndef ROCKY_ZAGROS_ETNA_SYSTEM_GUARD
+#define ROCKY_ZAGROS_ETNA_SYSTEM_GUARD
+#include<vector>
+#include<array>
+#include<cmath>
+#include<algorithm>
+#include<stdexcept>
+#include<thread>
+#include<type_traits>
+#include<atomic>
+#include<mutex>
+
+#include<tbb/tbb.h>
+
+#include<rocky/zagros/system.h>
+#include<rocky/etna/blocks.h>
+#include<rocky/etna/loss.h>
+#include<rocky/etna/dataset.h>
+#include<rocky/etna/quantized.h>
+
+namespace rocky{
+namespace zagros{
+
+using etna::dataset_view;
+
+/**
+ * @brief training an etna model on a dataset as a zagros system
+ *
+ * A solution holds all parameters of the model in the layout of the model.
+ * The dataset is fed in chunks of the model's batch size and the objective is
+ * the mean loss over all samples. Batches of solutions are evaluated with
+ * feed_population, so the input and target chunks are shared by a tile of
+ * networks while they are in cache.
+ * A runtime can restrict the objective to a mini-batch of samples, the selected
+ * rows are then gathered into a contiguous buffer. The next mini-batch can be
+ * gathered on a background thread while the current one is evaluated, which
+ * hides the page faults of a memory-mapped dataset.
+ * With a reduced-precision type T_q, e.g. etna::bf16 or std::int8_t, the
+ * solutions are quantized with one scale per layer before they are evaluated.
+ * Each chunk reads only the quantized parameters, which are dequantized layer
+ * by layer as they are fed, and the products still accumulate in T_e.
+ * In blocked descent with full-precision solutions, the activations of the
+ * leading layers that are not in the block are computed once per mask and
+ * each evaluation starts after them.
+ */
+template<typename T_e, typename T_model, typename T_loss=etna::loss::mse, typename T_q=T_e>
+class etna_system: public system<T_e>, public stochastic_objective<T_e>{
+protected:
+    static constexpr int batch_size_ = T_model::deduce_batch_size();
+    static constexpr int tile_ = T_model::population_tile;
+    static constexpr bool quantized_ = !std::is_same<T_e, T_q>::value;
+
+    // samples split into chunks of the model's batch size
+    struct data_chunks{
+        T_e* inputs;
+        T_e* targets;
+        long n_rows;
+        // number of chunks including a partial last chunk
+        long n_chunks;
+        // the buffers are zero-padded to a whole number of chunks
+        bool padded;
+    };
+
+    T_model model_;
+    dataset_view<T_e> data_;
+    // all samples
+    data_chunks full_;
+    // the selected mini-batch
+    data_chunks samples_;
+    // chunks used by objective and objective_batch
+    data_chunks* active_;
+    // zero-padded inputs and targets of the partial last chunk of the full data
+    std::vector<T_e> last_inputs_;
+    std::vector<T_e> last_targets_;
+    // gathered mini-batch
+    std::vector<T_e> sample_inputs_;
+    std::vector<T_e> sample_targets_;
+    // mini-batch gathered ahead of time by prefetch_thread_
+    std::vector<long> next_indices_;
+    std::vector<T_e> next_inputs_;
+    std::vector<T_e> next_targets_;
+    std::thread prefetch_thread_;
+    // per-layer bounds
+    std::vector<T_e> layer_lb_;
+    std::vector<T_e> layer_ub_;
+    // thread-specific output blocks of a tile
+    tbb::enumerable_thread_specific<std::vector<T_e>> outputs_;
+    // quantized solutions of the current batch
+    etna::quantized_params<T_e, T_q> population_;
+    // thread-specific quantized single solutions
+    tbb::enumerable_thread_specific<etna::quantized_params<T_e, T_q>> singles_;
+    // maximum deviation from the full-precision objective, negative when validation is disabled
+    T_e tolerance_ = -1.0;
+    // full-precision values of the current batch
+    std::vector<T_e> reference_values_;
+    T_e max_deviation_ = 0.0;
+    // number of leading layers that are not changed by the current block, 0 disables prefix caching
+    int prefix_layers_ = 0;
+    // the prefix parameters and the data the cached activations were computed for
+    std::vector<T_e> prefix_params_;
+    const data_chunks* prefix_data_ = nullptr;
+    // activations of the last prefix layer for each chunk
+    std::vector<T_e> prefix_activations_;
+    std::atomic<bool> prefix_ready_{false};
+    std::mutex prefix_mutex_;
+    // maximum number of samples whose activations are cached
+    long prefix_capacity_ = 1 << 16;
+
+    T_e* chunk_inputs(const data_chunks& d, long c){
+        if(!d.padded && (c + 1) * batch_size_ > d.n_rows)
+            return last_inputs_.data();
+        return d.inputs + c * T_model::deduce_in_size();
+    }
+    T_e* chunk_targets(const data_chunks& d, long c){
+        if(!d.padded && (c + 1) * batch_size_ > d.n_rows)
+            return last_targets_.data();
+        return d.targets + c * T_model::deduce_out_size();
+    }
+    static int chunk_rows(const data_chunks& d, long c){
+        return static_cast<int>(std::min<long>(batch_size_, d.n_rows - c * batch_size_));
+    }
+    T_e chunk_loss(const data_chunks& d, T_e* output, long c){
+        return T_loss::template sum<T_e, batch_size_, T_model::deduce_out_dim()>(output, chunk_targets(d, c), chunk_rows(d, c));
+    }
+    static T_e mean(const data_chunks& d, T_e loss_sum){
+        return loss_sum / T_loss::count(d.n_rows, T_model::deduce_out_dim());
+    }
+    static constexpr int prefix_size(){
+        return batch_size_ * T_model::deduce_layer_in_dim(1);
+    }
+    // the cached activations of a chunk if they were computed from the same prefix on the same data, otherwise null
+    T_e* prefix_activations(const data_chunks& d, T_e* params, long c=0){
+        if(prefix_layers_ == 0 || !prefix_ready_.load(std::memory_order_acquire) || prefix_data_ != &d || !std::equal(prefix_params_.begin(), prefix_params_.end(), params))
+            return nullptr;
+        return prefix_activations_.data() + c * prefix_size();
+    }
+    /**
+     * @brief compute the cached activations on the first evaluation after the cache is invalidated
+     * only the active data is cached if it has at most prefix_capacity_ samples, larger data
+     * is always fed from the input. the cache is never replaced while solutions are evaluated
+     *
+     */
+    void prepare_prefix(const data_chunks& d, T_e* params){
+        if(prefix_layers_ == 0 || &d != active_ || d.n_rows > prefix_capacity_ || prefix_ready_.load(std::memory_order_acquire))
+            return;
+        std::lock_guard<std::mutex> lock(prefix_mutex_);
+        if(prefix_ready_.load(std::memory_order_relaxed))
+            return;
+        prefix_params_.assign(params, params + T_model::deduce_layer_offset(prefix_layers_));
+        prefix_activations_.resize(d.n_chunks * prefix_size());
+        T_e* ws = etna::workspace<T_e>::local().reserve(T_model::deduce_workspace_size());
+        for(long c=0; c<d.n_chunks; c++)
+            model_.feed_prefix(params, chunk_inputs(d, c), prefix_layers_, prefix_activations_.data() + c * prefix_size(), ws);
+        prefix_data_ = &d;
+        prefix_ready_.store(true, std::memory_order_release);
+    }
+    void invalidate_prefix(){
+        prefix_ready_ = false;
+        prefix_data_ = nullptr;
+        prefix_params_.clear();
+    }
+    T_e evaluate(const data_chunks& d, T_e* params){
+        auto& output = outputs_.local();
+        output.resize(T_model::deduce_out_size());
+        prepare_prefix(d, params);
+        T_e* ws = etna::workspace<T_e>::local().reserve(T_model::deduce_workspace_size());
+        T_e* prefix = prefix_activations(d, params);
+        T_e loss_sum = 0.0;
+        for(long c=0; c<d.n_chunks; c++){
+            if(prefix)
+                model_.feed_suffix(params, prefix_layers_, prefix + c * prefix_size(), output.data(), ws);
+            else
+                model_.feed(params, chunk_inputs(d, c), output.data(), ws);
+            loss_sum += chunk_loss(d, output.data(), c);
+        }
+        return mean(d, loss_sum);
+    }
+    // gather the rows of some samples into zero-padded chunks
+    void gather(const long* indices, int n, std::vector<T_e>& inputs, std::vector<T_e>& targets, bool parallel){
+        const long n_chunks = (n + batch_size_ - 1) / batch_size_;
+        const int in_dim = T_model::deduce_in_dim();
+        const int out_dim = T_model::deduce_out_dim();
+        inputs.assign(n_chunks * T_model::deduce_in_size(), 0.0);
+        targets.assign(n_chunks * T_model::deduce_out_size(), 0.0);
+        auto copy_row = [&](int i){
+            std::copy(data_.inputs + indices[i] * in_dim, data_.inputs + (indices[i] + 1) * in_dim, inputs.data() + static_cast<long>(i) * in_dim);
+            std::copy(data_.targets + indices[i] * out_dim, data_.targets + (indices[i] + 1) * out_dim, targets.data() + static_cast<long>(i) * out_dim);
+        };
+        if(parallel)
+            tbb::parallel_for(0, n, copy_row);
+        else
+            for(int i=0; i<n; i++)
+                copy_row(i);
+    }
+    void wait_prefetch(){
+        if(prefetch_thread_.joinable())
+            prefetch_thread_.join();
+    }
+    /**
+     * @brief mean losses of a tile of solutions
+     *
+     * @param feed feed(c, out_ptrs, ws) computes the outputs of the tile on chunk c
+     */
+    template<typename T_feed>
+    void tile_losses(const data_chunks& d, int n_tile, T_e* values, T_feed feed){
+        auto& output = outputs_.local();
+        output.resize(tile_ * T_model::deduce_out_size());
+        std::array<T_e*, tile_> out_ptrs;
+        std::array<T_e, tile_> loss_sums;
+        for(int i=0; i<n_tile; i++){
+            out_ptrs[i] = output.data() + i * T_model::deduce_out_size();
+            loss_sums[i] = 0.0;
+        }
+        T_e* ws = etna::workspace<T_e>::local().reserve(T_model::deduce_population_workspace_size());
+        for(long c=0; c<d.n_chunks; c++){
+            feed(c, out_ptrs.data(), ws);
+            for(int i=0; i<n_tile; i++)
+                loss_sums[i] += chunk_loss(d, out_ptrs[i], c);
+        }
+        for(int i=0; i<n_tile; i++)
+            values[i] = mean(d, loss_sums[i]);
+    }
+    // evaluate a tile of solutions on all chunks
+    void evaluate_tile(const data_chunks& d, T_e** params, int n_tile, T_e* values){
+        // the solutions of a tile start from the cached activations only if they all share the cached prefix
+        prepare_prefix(d, params[0]);
+        bool from_prefix = prefix_activations(d, params[0]) != nullptr;
+        for(int i=1; i<n_tile && from_prefix; i++)
+            from_prefix = prefix_activations(d, params[i]) != nullptr;
+        tile_losses(d, n_tile, values, [&](long c, T_e** out_ptrs, T_e* ws){
+            if(from_prefix)
+                for(int i=0; i<n_tile; i++)
+                    model_.feed_suffix(params[i], prefix_layers_, prefix_activations_.data() + c * prefix_size(), out_ptrs[i], ws);
+            else
+                model_.feed_population(params, n_tile, chunk_inputs(d, c), out_ptrs, ws);
+        });
+    }
+    // evaluate a tile of quantized solutions on all chunks, no full-precision copy of the tile is made
+    void evaluate_tile(const data_chunks& d, const etna::quantized_params<T_e, T_q>& q, int first, int n_tile, T_e* values){
+        std::array<const T_q*, tile_> q_ptrs;
+        std::array<const T_e*, tile_> scale_ptrs;
+        for(int i=0; i<n_tile; i++){
+            q_ptrs[i] = q.values(first + i);
+            scale_ptrs[i] = q.scales(first + i);
+        }
+        tile_losses(d, n_tile, values, [&](long c, T_e** out_ptrs, T_e* ws){
+            model_.feed_population(q_ptrs.data(), scale_ptrs.data(), n_tile, chunk_inputs(d, c), out_ptrs, ws);
+        });
+    }
+    // evaluate a single solution in the precision of the system
+    T_e evaluate_solution(const data_chunks& d, T_e* params){
+        if constexpr (!quantized_)
+            return evaluate(d, params);
+        else{
+            auto& single = singles_.local();
+            single.resize(1);
+            single.quantize(0, params);
+            T_e value;
+            evaluate_tile(d, single, 0, 1, &value);
+            return value;
+        }
+    }
+    int layer_of(int p_index){
+        int layer = 0;
+        while(layer + 1 < T_model::deduce_num_layers() && T_model::deduce_layer_offset(layer + 1) <= p_index)
+            layer++;
+        return layer;
+    }
+
+public:
+    /**
+     * @param data dataset, the model's batch size does not need to divide the number of samples
+     * @param bound bound of all parameters, see set_layer_bounds and glorot_bounds
+     */
+    etna_system(dataset_view<T_e> data, T_e bound=1.0)
+    :layer_lb_(T_model::deduce_num_layers(), -bound), layer_ub_(T_model::deduce_num_layers(), bound),
+     population_(etna::quantized_params<T_e, T_q>::template layer_offsets<T_model>()),
+     singles_(etna::quantized_params<T_e, T_q>(etna::quantized_params<T_e, T_q>::template layer_offsets<T_model>())){
+        if(data.n_rows <= 0)
+            throw std::invalid_argument("etna_system: empty dataset");
+        if(data.in_dim != T_model::deduce_in_dim() || data.out_dim != T_model::deduce_out_dim())
+            throw std::invalid_argument("etna_system: the dimensions of the dataset do not match the model");
+        this->data_ = data;
+        this->full_ = {data.inputs, data.targets, data.n_rows, (data.n_rows + batch_size_ - 1) / batch_size_, false};
+        this->active_ = &full_;
+        long last = full_.n_chunks - 1;
+        int last_rows = chunk_rows(full_, last);
+        if(last_rows < batch_size_){
+            last_inputs_.assign(T_model::deduce_in_size(), 0.0);
+            last_targets_.assign(T_model::deduce_out_size(), 0.0);
+            std::copy(data.inputs + last * T_model::deduce_in_size(),
+                      data.inputs + last * T_model::deduce_in_size() + static_cast<long>(last_rows) * T_model::deduce_in_dim(),
+                      last_inputs_.begin());
+            std::copy(data.targets + last * T_model::deduce_out_size(),
+                      data.targets + last * T_model::deduce_out_size() + static_cast<long>(last_rows) * T_model::deduce_out_dim(),
+                      last_targets_.begin());
+        }
+    }
+    // the active chunks point into the system itself
+    etna_system(const etna_system&) = delete;
+    etna_system& operator=(const etna_system&) = delete;
+    virtual ~etna_system(){
+        wait_prefetch();
+    }
+    static constexpr int dim(){
+        return T_model::deduce_num_params();
+    }
+    /**
+     * @brief bounds of the parameters of a layer
+     *
+     * @param layer layer index, 0 is the input layer
+     * @param lb lower bound
+     * @param ub upper bound
+     */
+    void set_layer_bounds(int layer, T_e lb, T_e ub){
+        layer_lb_.at(layer) = lb;
+        layer_ub_.at(layer) = ub;
+    }
+    // bound each layer by sqrt(6 / (fan_in + fan_out))
+    void glorot_bounds(){
+        for(int l=0; l<T_model::deduce_num_layers(); l++){
+            T_e bound = std::sqrt(6.0 / (T_model::deduce_layer_in_dim(l) + T_model::deduce_layer_out_dim(l)));
+            set_layer_bounds(l, -bound, bound);
+        }
+    }
+    /**
+     * @brief compare quantized evaluations of batches with full precision
+     * every solution of a batch is evaluated twice and a warning is logged when
+     * the values differ by more than `tolerance`, see max_deviation
+     *
+     * @param tolerance maximum absolute deviation of an objective value
+     */
+    void enable_validation(T_e tolerance){
+        tolerance_ = tolerance;
+    }
+    // the largest deviation of the last validated batch
+    T_e max_deviation(){
+        return max_deviation_;
+    }
+    /**
+     * @brief limit the memory of the cached activations in blocked descent
+     * data with more samples, e.g. a large dataset without a mini-batch, is fed from the input
+     *
+     * @param n_rows maximum number of samples whose activations are cached
+     */
+    void set_prefix_capacity(long n_rows){
+        invalidate_prefix();
+        prefix_capacity_ = n_rows;
+        std::vector<T_e>().swap(prefix_activations_);
+    }
+    // whether the activations of the leading layers are cached for the active data
+    bool prefix_cached(){
+        return prefix_ready_.load(std::memory_order_acquire) && prefix_data_ == active_;
+    }
+    virtual T_e objective(T_e* params){
+        return evaluate_solution(*active_, params);
+    }
+    virtual T_e objective_full(T_e* params){
+        return evaluate_solution(full_, params);
+    }
+    virtual long n_samples(){
+        return data_.n_rows;
+    }
+    virtual void set_samples(const long* indices, int n){
+        invalidate_prefix();
+        if(n <= 0){
+            active_ = &full_;
+            return;
+        }
+        wait_prefetch();
+        if(next_indices_.size() == static_cast<size_t>(n) && std::equal(next_indices_.begin(), next_indices_.end(), indices)){
+            std::swap(sample_inputs_, next_inputs_);
+            std::swap(sample_targets_, next_targets_);
+        }
+        else
+            gather(indices, n, sample_inputs_, sample_targets_, true);
+        next_indices_.clear();
+        samples_ = {sample_inputs_.data(), sample_targets_.data(), n, (n + batch_size_ - 1) / batch_size_, true};
+        active_ = &samples_;
+    }
+    virtual void prefetch_samples(const long* indices, int n){
+        wait_prefetch();
+        next_indices_.assign(indices, indices + n);
+        if(n <= 0)
+            return;
+        prefetch_thread_ = std::thread([this](){
+            gather(next_indices_.data(), next_indices_.size(), next_inputs_, next_targets_, false);
+        });
+    }
+    virtual void objective_batch(T_e** params, T_e* values, int n){
+        const data_chunks& d = *active_;
+        const int n_tiles = (n + tile_ - 1) / tile_;
+        if constexpr (!quantized_){
+            tbb::parallel_for(0, n_tiles, [&](int t){
+                const int first = t * tile_;
+                evaluate_tile(d, params + first, std::min(tile_, n - first), values + first);
+            });
+        }
+        else{
+            population_.resize(n);
+            tbb::parallel_for(0, n, [&](int i){
+                population_.quantize(i, params[i]);
+            });
+            const bool validate = tolerance_ >= 0;
+            if(validate)
+                reference_values_.resize(n);
+            tbb::parallel_for(0, n_tiles, [&](int t){
+                const int first = t * tile_;
+                const int n_tile = std::min(tile_, n - first);
+                evaluate_tile(d, population_, first, n_tile, values + first);
+                if(validate)
+                    evaluate_tile(d, params + first, n_tile, reference_values_.data() + first);
+            });
+            if(validate){
+                max_deviation_ = 0.0;
+                for(int i=0; i<n; i++)
+                    max_deviation_ = std::max<T_e>(max_deviation_, std::abs(values[i] - reference_values_[i]));
+                if(max_deviation_ > tolerance_)
+                    spdlog::warn("etna system: the quantized objective deviates by up to {} from full precision", max_deviation_);
+            }
+        }
+    }
+    /**
+     * @brief cache the activations of the leading layers that are not in the block
+     * the cache is computed on the next evaluation and used by every solution
+     * whose leading layers have the same parameters
+     *
+     * @param block_mask indices of the parameters in the block
+     * @param block_dim number of parameters in the block
+     */
+    virtual void optimize_for_block(int* block_mask, int block_dim){
+        invalidate_prefix();
+        int first_layer = T_model::deduce_num_layers() - 1;
+        for(int i=0; i<block_dim; i++)
+            first_layer = std::min(first_layer, layer_of(block_mask[i]));
+        prefix_layers_ = (block_dim < dim()) ? first_layer : 0;
+    }
+    // a tile of networks shares each pass over the data
+    virtual bool batched(){
+        return true;
+    }
+    virtual T_e lower_bound(int p_index){
+        return layer_lb_[layer_of(p_index)];
+    }
+    virtual T_e upper_bound(int p_index){
+        return layer_ub_[layer_of(p_index)];
+    }
+    virtual std::string to_string(){
+        return "etna system";
+    }
+};
+
+}; // end of zagros namespace
+}; // end of rocky namespace
+#endif
@@ -4,6 +4,7 @@
 */
 #ifndef ROCKY_ZAGROS_FLOW_GUARD
 #define ROCKY_ZAGROS_FLOW_GUARD
+#include<unordered_set>
 
 
 #include<rocky/zagros/strategies/init.h>
@@ -13,9 +14,11 @@
 #include<rocky/zagros/strategies/genetic.h>
 #include<rocky/zagros/strategies/differential_evolution.h>
 #include<rocky/zagros/strategies/eda.h>
+#include<rocky/zagros/strategies/cmaes.h>
 #include<rocky/zagros/strategies/blocked_descent.h>
 #include<rocky/zagros/strategies/container_manipulation.h>
 #include<rocky/zagros/dena.h>
+#include<rocky/zagros/cached_system.h>
 
 
 
@@ -39,6 +42,28 @@ public:
     std::map<int, int> iter_counter;
     // tracking the convergence of containers
     std::map<int, std::deque<T_e>> conv_tracker;
+    // success history of self-adaptive differential evolution nodes
+    std::map<int, de_success_history<T_e>> de_history;
+    // maximum number of candidates in flight for pipelined strategies, 0 disables pipelining
+    int pipeline_tokens = 0;
+    // surrogate screening shared by search strategies, null when disabled
+    std::unique_ptr<surrogate_screen<T_e, T_block_dim>> surrogate;
+    // evaluators of steady-state nodes
+    std::map<int, std::unique_ptr<steady_state_evaluator<T_e, T_block_dim>>> steady_state;
+    // the objective as a stochastic objective, null if it does not average over samples
+    stochastic_objective<T_e>* stochastic = nullptr;
+    // current mini-batch size of each mini-batch node
+    std::map<int, double> minibatch_size;
+    // indices of the selected mini-batch, empty when all samples are used
+    std::vector<long> minibatch;
+    // indices of the following mini-batch of each mini-batch node, drawn one step ahead
+    std::map<int, std::vector<long>> next_minibatch;
+    // score candidates for the best solution on all samples before promoting them
+    bool rescore_best = false;
+    // the last candidate scored on all samples, to avoid scoring it again
+    std::vector<T_e> last_rescored;
+    // memoized objective, cleared when the mini-batch changes
+    cached_system<T_e>* cache = nullptr;
     // a mask representing active variables in blocked descent
     std::vector<int> bcd_mask;
     // state of blocked systems
@@ -107,15 +132,95 @@ public:
             }        
         }
         if (best.first < partial_best->values[0]){
+            T_e* candidate = cnt_storage[best_ci]->particle(best.second);
+            // mini-batch values are only estimates, the best solution keeps its value on all samples
+            if(rescore_best && stochastic && !minibatch.empty()){
+                if(std::equal(candidate, candidate + T_block_dim, last_rescored.begin(), last_rescored.end()))
+                    return;
+                last_rescored.assign(candidate, candidate + T_block_dim);
+                best.first = stochastic->objective_full(complete_solution(candidate));
+                if(best.first >= partial_best->values[0])
+                    return;
+            }
             // copy the best solution to the container
-            std::copy(cnt_storage[best_ci]->particle(best.second),
-                    cnt_storage[best_ci]->particle(best.second)+T_block_dim,
-                    partial_best->particle(0));
+            std::copy(candidate, candidate + T_block_dim, partial_best->particle(0));
             
             // copy the corresponding min value
             partial_best->values[0] = best.first;
         }
     }
+    // a full solution from a partial solution of the current block
+    T_e* complete_solution(T_e* partial){
+        if constexpr(T_dim == T_block_dim)
+            return partial;
+        else{
+            std::vector<T_e>& full = th_blocked_states.local();
+            std::copy(blocked_state->particle(0), blocked_state->particle(0) + T_dim, full.begin());
+            for(int i=0; i<T_block_dim; i++)
+                full[bcd_mask[i]] = partial[i];
+            return full.data();
+        }
+    }
+    /**
+     * @brief draw sorted sample indices without replacement
+     * 
+     * @param n_samples number of samples
+     * @param size size of the mini-batch
+     * @return std::vector<long> 
+     */
+    std::vector<long> draw_minibatch(long n_samples, long size){
+        // Floyd's sampling without replacement
+        std::unordered_set<long> selected;
+        selected.reserve(size);
+        for(long j=n_samples-size; j<n_samples; j++){
+            long t = std::uniform_int_distribution<long>(0, j)(utils::random::prng());
+            if(!selected.insert(t).second)
+                selected.insert(j);
+        }
+        std::vector<long> indices(selected.begin(), selected.end());
+        std::sort(indices.begin(), indices.end());
+        return indices;
+    }
+    // size of the next mini-batch of a node, a size of n_samples selects all samples
+    long next_minibatch_size(const dena::stochastic_minibatch_node& node, long n_samples){
+        long limit = (node.max_batch_size > 0) ? std::min<long>(node.max_batch_size, n_samples) : n_samples;
+        return std::min<long>(std::lround(minibatch_size[node.tag]), limit);
+    }
+    /**
+     * @brief select a new mini-batch of samples and grow the mini-batch size
+     * the following mini-batch is drawn ahead of time, so the objective can prefetch its samples
+     * 
+     * @param node mini-batch node
+     * @return * void 
+     */
+    void select_minibatch(const dena::stochastic_minibatch_node& node){
+        long n_samples = stochastic->n_samples();
+        long size = next_minibatch_size(node, n_samples);
+        minibatch_size[node.tag] *= node.growth;
+        if(size >= n_samples){
+            minibatch.clear();
+            stochastic->set_samples(nullptr, 0);
+        }
+        else{
+            auto drawn = next_minibatch.find(node.tag);
+            if(drawn != next_minibatch.end() && static_cast<long>(drawn->second.size()) == size)
+                minibatch.swap(drawn->second);
+            else
+                minibatch = draw_minibatch(n_samples, size);
+            stochastic->set_samples(minibatch.data(), minibatch.size());
+        }
+        long following = next_minibatch_size(node, n_samples);
+        if(following < n_samples){
+            next_minibatch[node.tag] = draw_minibatch(n_samples, following);
+            stochastic->prefetch_samples(next_minibatch[node.tag].data(), following);
+        }
+        else
+            next_minibatch.erase(node.tag);
+        // values of the previous mini-batch are no longer valid
+        if(cache)
+            cache->clear();
+        last_rescored.clear();
+    }
     // synchronize best partial solution
     void sync_partial_best(){
         // Assumption : update_partial_best has been called already
@@ -130,6 +235,45 @@ public:
             for(int i=0; i<T_block_dim; i++)
                 th_state[bcd_mask[i]] = partial_best->particles[0][i];
     }
+    // apply runtime-wide evaluation settings to a strategy that produces candidates one at a time
+    void configure_operator(candidate_operator<T_e, T_block_dim>* op, system<T_e>* problem){
+        if(pipeline_tokens > 0)
+            op->enable_pipeline(problem, pipeline_tokens);
+    }
+    /**
+     * @brief the steady-state evaluator of a node, created on first use from the
+     * candidate operators of the wrapped flow
+     * 
+     * @param node steady-state node
+     * @param problem objective system
+     * @return * steady_state_evaluator<T_e, T_block_dim>* 
+     */
+    steady_state_evaluator<T_e, T_block_dim>* steady_state_evaluator_for(const dena::run_steady_state_node& node, system<T_e>* problem){
+        auto& evaluator = steady_state[node.tag];
+        if(evaluator)
+            return evaluator.get();
+        evaluator = std::make_unique<steady_state_evaluator<T_e, T_block_dim>>(problem, node.n_workers);
+        for(int it = node.sub_procedure.front(); it > -1; it = dena::node::next(it)){
+            auto str_it = str_storage.find(it);
+            if(str_it == str_storage.end())
+                continue;
+            for(auto& str: str_it->second){
+                auto op = dynamic_cast<candidate_operator<T_e, T_block_dim>*>(str.get());
+                if(op)
+                    evaluator->add_operator(op);
+                else
+                    spdlog::warn("node {} does not produce single candidates and is ignored in steady-state mode", it);
+            }
+        }
+        if(evaluator->n_operators() == 0)
+            spdlog::warn("steady-state node {} has no strategy to run", node.tag);
+        return evaluator.get();
+    }
+    // let a strategy screen its candidates with the runtime's surrogate
+    void configure_surrogate(surrogate_assisted<T_e, T_block_dim>* str){
+        if(surrogate)
+            str->enable_surrogate(surrogate.get());
+    }
     // reset all solution containers
     void reset(){
         for(auto& cnt: cnt_storage)
@@ -137,6 +281,9 @@ public:
         for(auto& [tag, str_vec]: str_storage)
             for(auto& str: str_vec)
                 str->reset();
+        // archived partial solutions belong to the previous block
+        if(surrogate)
+            surrogate->reset();
     }
 };
 
@@ -172,6 +319,14 @@ struct allocation_visitor{
         main_storage->iter_counter[node.tag] = 0;
         path_stack->push(node.sub_procedure.front());
     }
+    void operator()(dena::run_steady_state_node node){
+        path_stack->push(node.sub_procedure.front());
+    }
+    void operator()(dena::stochastic_minibatch_node node){
+        main_storage->minibatch_size[node.tag] = node.batch_size;
+        if(!main_storage->stochastic)
+            spdlog::warn("the objective is not a stochastic objective, mini-batch node {} is ignored", node.tag);
+    }
     void operator()(dena::run_with_probability_node node){
         path_stack->push(node.sub_procedure.front());
     }
@@ -180,6 +335,7 @@ struct allocation_visitor{
     }
     void operator()(dena::container_select_from_node node){}
     void operator()(dena::container_eval_node node){}
+    void operator()(dena::container_eval_successive_halving_node node){}
     void operator()(dena::pso_memory_create_node node){
         // allocate required solution containers for particle swarm
         auto main_cnt = main_storage->container(node.main_cnt_id);
@@ -201,6 +357,16 @@ struct allocation_visitor{
     }
     void operator()(dena::pso_group_level_step_node node){}
     void operator()(dena::pso_cluster_level_step_node node){}
+    void operator()(dena::cmaes_memory_create_node node){
+        // the population container bounds the population growth of restarts
+        int max_population = node.max_population;
+        if(max_population <= 0)
+            max_population = 16 * basic_cmaes<T_e, T_block_dim>::default_population(T_block_dim);
+        main_storage->allocate_container(dena::cmaes::memory::population(node.memory_id), max_population, max_population);
+    }
+    void operator()(dena::cmaes_step_node node){}
+    void operator()(dena::cmaes_sep_step_node node){}
+    void operator()(dena::cmaes_lm_step_node node){}
     void operator()(dena::mutate_gaussian_node node){
         // allocate required solution containers for particle swarm
         auto main_cnt = main_storage->container(node.id);
@@ -222,13 +388,36 @@ struct allocation_visitor{
     void operator()(dena::eda_mvn_fullcov_node node){
         // allocate required solution container
         auto main_cnt = main_storage->container(node.id);
-        int n_particles = main_cnt->n_particles();
-        int temp_size = T_block_dim;
-        if(n_particles < temp_size){
-            temp_size = n_particles;
+        if(main_cnt->n_particles() < T_block_dim)
             spdlog::warn("For using EDA it is recommended to choose number of particles larger than BCD block");
-        }
-        main_storage->allocate_container(dena::utils::temp_name(node.tag), T_block_dim, T_block_dim);
+        int n_candidates = (node.n_candidates > 0) ? node.n_candidates : T_block_dim;
+        main_storage->allocate_container(dena::utils::temp_name(node.tag), n_candidates, n_candidates);
+    }
+    void operator()(dena::eda_mvn_incremental_node node){
+        // allocate required solution container
+        auto main_cnt = main_storage->container(node.id);
+        int n_particles = main_cnt->n_particles();
+        main_storage->allocate_container(dena::utils::temp_name(node.tag), n_particles, n_particles);
+    }
+    void operator()(dena::eda_mvn_diagonal_node node){
+        // allocate required solution container
+        auto main_cnt = main_storage->container(node.id);
+        int n_candidates = (node.n_candidates > 0) ? node.n_candidates : main_cnt->n_particles();
+        main_storage->allocate_container(dena::utils::temp_name(node.tag), n_candidates, n_candidates);
+    }
+    void operator()(dena::eda_mvn_lowrank_node node){
+        // allocate required solution container
+        auto main_cnt = main_storage->container(node.id);
+        int n_candidates = (node.n_candidates > 0) ? node.n_candidates : main_cnt->n_particles();
+        main_storage->allocate_container(dena::utils::temp_name(node.tag), n_candidates, n_candidates);
+    }
+    void operator()(dena::de_step_node node){
+        // allocate required solution container
+        auto main_cnt = main_storage->container(node.id);
+        int n_particles = main_cnt->n_particles();
+        main_storage->allocate_container(dena::utils::temp_name(node.tag), n_particles, n_particles);
+        // the success history lives as long as the runtime
+        main_storage->de_history[node.tag].resize(node.memory_size, node.crossover_prob, node.differential_weight);
     }
     void operator()(dena::crossover_segment_node node){
         // allocate required solution container
@@ -313,6 +502,10 @@ struct assigning_visitor{
     void operator()(dena::run_every_n_steps_node node){
         path_stack->push(node.sub_procedure.front());
     }
+    void operator()(dena::run_steady_state_node node){
+        path_stack->push(node.sub_procedure.front());
+    }
+    void operator()(dena::stochastic_minibatch_node node){}
     void operator()(dena::container_create_node node){}
     void operator()(dena::container_select_from_node node){
         auto des_cnt = main_storage->container(node.des);
@@ -325,7 +518,34 @@ struct assigning_visitor{
         auto str = std::make_unique<eval_strategy<T_e, T_block_dim>>(problem, cnt);
         main_storage->str_storage[node.tag].push_back(std::move(str));
     }
+    void operator()(dena::container_eval_successive_halving_node node){
+        auto cnt = main_storage->container(node.id);
+        auto str = std::make_unique<successive_halving_eval_strategy<T_e, T_block_dim>>(problem, cnt, node.min_fidelity, node.eta);
+        main_storage->str_storage[node.tag].push_back(std::move(str));
+    }
     void operator()(dena::pso_memory_create_node node){}
+    void operator()(dena::cmaes_memory_create_node node){}
+    void operator()(dena::cmaes_step_node node){
+        auto main_cnt = main_storage->container(node.main_cnt_id);
+        auto population = main_storage->container(dena::cmaes::memory::population(node.memory_id));
+        auto str = std::make_unique<cmaes_strategy<T_e, T_block_dim>>(problem, main_cnt, population, static_cast<cmaes_restart>(node.restart), node.sigma);
+        // add the strategy to the container
+        main_storage->str_storage[node.tag].push_back(std::move(str));
+    }
+    void operator()(dena::cmaes_sep_step_node node){
+        auto main_cnt = main_storage->container(node.main_cnt_id);
+        auto population = main_storage->container(dena::cmaes::memory::population(node.memory_id));
+        auto str = std::make_unique<sep_cmaes_strategy<T_e, T_block_dim>>(problem, main_cnt, population, static_cast<cmaes_restart>(node.restart), node.sigma);
+        // add the strategy to the container
+        main_storage->str_storage[node.tag].push_back(std::move(str));
+    }
+    void operator()(dena::cmaes_lm_step_node node){
+        auto main_cnt = main_storage->container(node.main_cnt_id);
+        auto population = main_storage->container(dena::cmaes::memory::population(node.memory_id));
+        auto str = std::make_unique<lm_ma_es_strategy<T_e, T_block_dim>>(problem, main_cnt, population, static_cast<cmaes_restart>(node.restart), node.sigma, node.n_paths);
+        // add the strategy to the container
+        main_storage->str_storage[node.tag].push_back(std::move(str));
+    }
     void operator()(dena::pso_group_level_step_node node){
         // get memory containers
         using namespace dena;
@@ -356,6 +576,8 @@ struct assigning_visitor{
         auto main_cnt = main_storage->container(node.id);
         auto temp_cnt = main_storage->container(dena::utils::temp_name(node.tag));
         auto str = std::make_unique<gaussian_mutation<T_e, T_block_dim>>(problem, main_cnt, temp_cnt, node.dims, node.mu, node.sigma);
+        main_storage->configure_surrogate(str.get());
+        main_storage->configure_operator(str.get(), problem);
         // add the strategy to the container
         main_storage->str_storage[node.tag].push_back(std::move(str));
     }
@@ -370,13 +592,72 @@ struct assigning_visitor{
         auto main_cnt = main_storage->container(node.id);
         auto temp_cnt = main_storage->container(dena::utils::temp_name(node.tag));
         auto str = std::make_unique<basic_differential_evolution<T_e, T_block_dim>>(problem, main_cnt, temp_cnt, node.crossover_prob, node.differential_weight);
+        main_storage->configure_surrogate(str.get());
+        main_storage->configure_operator(str.get(), problem);
         // add the strategy to the container
         main_storage->str_storage[node.tag].push_back(std::move(str));
     }
     void operator()(dena::eda_mvn_fullcov_node node){
         auto main_cnt = main_storage->container(node.id);
         auto temp_cnt = main_storage->container(dena::utils::temp_name(node.tag));
-        auto str = std::make_unique<eda_mutivariate_normal<T_e, T_block_dim>>(problem, main_cnt, temp_cnt, T_block_dim);
+        // the top-k selection cannot take more solutions than the container holds
+        int sample_size = std::min(T_block_dim, main_cnt->n_particles());
+        auto str = std::make_unique<eda_mutivariate_normal<T_e, T_block_dim>>(problem, main_cnt, temp_cnt, sample_size);
+        main_storage->configure_surrogate(str.get());
+        main_storage->configure_operator(str.get(), problem);
+        // add the strategy to the container
+        main_storage->str_storage[node.tag].push_back(std::move(str));
+    }
+    void operator()(dena::eda_mvn_incremental_node node){
+        auto main_cnt = main_storage->container(node.id);
+        auto temp_cnt = main_storage->container(dena::utils::temp_name(node.tag));
+        int sample_size = node.sample_size;
+        if(sample_size <= 0)
+            sample_size = main_cnt->n_particles() / 4;
+        sample_size = std::clamp(sample_size, 2, main_cnt->n_particles());
+        auto str = std::make_unique<eda_incremental_mvn<T_e, T_block_dim>>(problem, main_cnt, temp_cnt, sample_size, node.learning_rate, node.refactor_period);
+        main_storage->configure_surrogate(str.get());
+        main_storage->configure_operator(str.get(), problem);
+        // add the strategy to the container
+        main_storage->str_storage[node.tag].push_back(std::move(str));
+    }
+    void operator()(dena::eda_mvn_diagonal_node node){
+        auto main_cnt = main_storage->container(node.id);
+        auto temp_cnt = main_storage->container(dena::utils::temp_name(node.tag));
+        int sample_size = node.sample_size;
+        if(sample_size <= 0)
+            sample_size = main_cnt->n_particles() / 2;
+        sample_size = std::clamp(sample_size, 2, main_cnt->n_particles());
+        auto str = std::make_unique<eda_diagonal_normal<T_e, T_block_dim>>(problem, main_cnt, temp_cnt, sample_size);
+        main_storage->configure_surrogate(str.get());
+        // add the strategy to the container
+        main_storage->str_storage[node.tag].push_back(std::move(str));
+    }
+    void operator()(dena::eda_mvn_lowrank_node node){
+        auto main_cnt = main_storage->container(node.id);
+        auto temp_cnt = main_storage->container(dena::utils::temp_name(node.tag));
+        int sample_size = node.sample_size;
+        if(sample_size <= 0)
+            sample_size = main_cnt->n_particles() / 2;
+        sample_size = std::clamp(sample_size, 2, main_cnt->n_particles());
+        if(node.rank >= sample_size)
+            spdlog::warn("rank of the low-rank EDA is limited to {} by the number of particles", sample_size - 1);
+        auto str = std::make_unique<eda_low_rank_normal<T_e, T_block_dim>>(problem, main_cnt, temp_cnt, sample_size, node.rank);
+        main_storage->configure_surrogate(str.get());
+        // add the strategy to the container
+        main_storage->str_storage[node.tag].push_back(std::move(str));
+    }
+    void operator()(dena::de_step_node node){
+        auto main_cnt = main_storage->container(node.id);
+        auto temp_cnt = main_storage->container(dena::utils::temp_name(node.tag));
+        auto str = std::make_unique<adaptive_differential_evolution<T_e, T_block_dim>>(problem, main_cnt, temp_cnt,
+                                                                                       static_cast<de_mutation>(node.mutation),
+                                                                                       static_cast<de_adaptation>(node.adaptation),
+                                                                                       &(main_storage->de_history[node.tag]),
+                                                                                       node.crossover_prob, node.differential_weight,
+                                                                                       node.p_best_rate, node.learning_rate);
+        main_storage->configure_surrogate(str.get());
+        main_storage->configure_operator(str.get(), problem);
         // add the strategy to the container
         main_storage->str_storage[node.tag].push_back(std::move(str));
     }
@@ -389,6 +670,8 @@ struct assigning_visitor{
             spdlog::warn("segment length must be less than BCD block size!");
         }
         auto str = std::make_unique<static_segment_crossover<T_e, T_block_dim>>(problem, main_cnt, temp_cnt, segment_length);
+        main_storage->configure_surrogate(str.get());
+        main_storage->configure_operator(str.get(), problem);
         // add the strategy to the container
         main_storage->str_storage[node.tag].push_back(std::move(str));
     }
@@ -446,6 +729,12 @@ struct running_visitor{
                 if(p == 0)
                     (*traverse_fn)(node.sub_procedure.front(), problem, main_storage);
             }
+            if constexpr (std::is_base_of<dena::run_steady_state_node, T_n>::value){
+                auto evaluator = main_storage->steady_state_evaluator_for(node, problem);
+                int accepted = evaluator->run(node.n_evaluations);
+                main_storage->update_partial_best();
+                spdlog::info("steady-state evaluation accepted {} of {} candidates", accepted, node.n_evaluations);
+            }
             if constexpr (std::is_base_of<dena::run_until_no_improve_node, T_n>::value){
                 int checks = 0;
                 T_e value = main_storage->container(node.id)->best_min();
@@ -462,6 +751,15 @@ struct running_visitor{
             }
             return;
         }
+        if constexpr (std::is_base_of<dena::stochastic_minibatch_node, T_n>::value){
+            if(!main_storage->stochastic)
+                return;
+            main_storage->select_minibatch(node);
+            // compare the solutions on the new mini-batch
+            main_storage->container(node.id)->evaluate_and_update(problem);
+            main_storage->update_partial_best();
+            return;
+        }
         if constexpr (std::is_base_of<dena::bcd_mask_node, T_n>::value){
             if constexpr(T_block_dim == T_dim)
                 return;
@@ -500,6 +798,8 @@ public:
     // objective system
     system<T_e>* problem;
     std::unique_ptr<blocked_system<T_e>> blocked_problem;
+    // memoization of the objective, null when disabled
+    std::unique_ptr<cached_system<T_e>> cache;
     runtime_storage<T_e, T_dim, T_block_dim> storage;
 
     // check if the objective system is blocked 
@@ -515,6 +815,7 @@ public:
     }
     basic_runtime(system<T_e>* problem){
         this->problem = problem;
+        storage.stochastic = dynamic_cast<stochastic_objective<T_e>*>(problem);
         storage.partial_best = std::make_unique<basic_scontainer<T_e, T_block_dim>>(1, 1);
         storage.partial_best->allocate();
     
@@ -540,6 +841,62 @@ public:
             this->blocked_problem->optimization_for_block();            
         } 
     }
+    /**
+     * @brief stream the candidates of supported strategies through generation, evaluation and merging
+     * instead of separating these phases by barriers
+     * 
+     * @param n_tokens maximum number of candidates in flight, 0 selects twice the number of threads
+     * @return * void 
+     */
+    void enable_pipelining(int n_tokens=0){
+        if(n_tokens <= 0)
+            n_tokens = 2 * tbb::this_task_arena::max_concurrency();
+        storage.pipeline_tokens = n_tokens;
+    }
+    /**
+     * @brief screen the candidates of search strategies with a k-NN surrogate
+     * and only evaluate the ones predicted to replace a solution
+     * 
+     * @param k number of neighbors
+     * @param capacity maximum number of archived evaluations
+     * @param min_fraction fraction of the candidates that is always evaluated
+     * @return * void 
+     */
+    void enable_surrogate(int k=8, int capacity=1024, T_e min_fraction=0.1){
+        storage.surrogate = std::make_unique<surrogate_screen<T_e, T_block_dim>>(k, capacity, min_fraction);
+    }
+    /**
+     * @brief memoize the objective values of full solutions
+     * 
+     * @param capacity maximum number of cached values
+     * @param quantum width of the quantization grid, zero only matches exact duplicates
+     * @param n_shards number of independently locked shards
+     * @return * void 
+     */
+    void enable_cache(int capacity=65536, T_e quantum=0.0, int n_shards=64){
+        if(cache){
+            spdlog::warn("objective cache is already enabled");
+            return;
+        }
+        cache = std::make_unique<cached_system<T_e>>(problem, T_dim, capacity, quantum, n_shards);
+        storage.cache = cache.get();
+        // blocked systems complete the partial solutions before calling the cache
+        if(blocked())
+            blocked_problem->main_system_ = cache.get();
+        else
+            problem = cache.get();
+    }
+    /**
+     * @brief score the candidates for the best solution on all samples of a stochastic objective
+     * so that the best solution is not selected by the noise of a mini-batch
+     * 
+     * @return * void 
+     */
+    void enable_best_rescoring(){
+        if(!storage.stochastic)
+            spdlog::warn("the objective is not a stochastic objective, rescoring has no effect");
+        storage.rescore_best = true;
+    }
     void run(const dena::flow& fl){
         // allocate memory for running the flow
         this->traverse_allocate(fl);
@@ -550,6 +907,10 @@ public:
         spdlog::info("assignment finished");
         // run the flow recursively
         this->traverse_run(fl);
+        if(storage.surrogate)
+            spdlog::info("surrogate saved {} of {} evaluations", storage.surrogate->n_saved(), storage.surrogate->n_candidates());
+        if(cache)
+            spdlog::info("objective cache hits : {} misses : {} hit rate : {:.2f}%", cache->hits(), cache->misses(), 100.0 * cache->hit_rate());
     }
     /**
      * @brief allocate required memory for running the flow
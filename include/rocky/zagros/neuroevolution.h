@@ -0,0 +1,87 @@
+/*
+    Copyright (C) 2022 Amirabbas Asadi , All Rights Reserved
+    distributed under Apache-2.0 license
+*/
+#ifndef ROCKY_ZAGROS_NEUROEVOLUTION_GUARD
+#define ROCKY_ZAGROS_NEUROEVOLUTION_GUARD
+#include<vector>
+#include<array>
+
+#include<tbb/tbb.h>
+
+#include<rocky/zagros/system.h>
+#include<rocky/etna/blocks.h>
+
+namespace rocky{
+namespace zagros{
+
+/**
+ * @brief base class for systems whose solutions are the parameters of an etna model
+ *
+ * All solutions are evaluated on the same input block, so a batch of solutions
+ * is fed through the model with feed_population and the input layers of
+ * several networks share one matrix product.
+ * Derived classes only define the loss of the model output.
+ */
+template<typename T_e, typename T_model>
+class neuroevolution_system: public system<T_e>{
+protected:
+    T_model model_;
+    // input block shared by all solutions
+    T_e* input_;
+    // thread-specific output blocks
+    tbb::enumerable_thread_specific<std::vector<T_e>> outputs_;
+
+public:
+    /**
+     * @param input input block with T_model::deduce_in_size() elements
+     */
+    neuroevolution_system(T_e* input){
+        this->input_ = input;
+    }
+    static constexpr int dim(){
+        return T_model::deduce_num_params();
+    }
+    /**
+     * @brief loss of a model output
+     *
+     * @param output output block with T_model::deduce_out_size() elements
+     * @return T_e
+     */
+    virtual T_e loss(T_e* output) = 0;
+    virtual T_e objective(T_e* params){
+        auto& output = outputs_.local();
+        output.resize(T_model::deduce_out_size());
+        T_e* ws = etna::workspace<T_e>::local().reserve(T_model::deduce_workspace_size());
+        model_.feed(params, input_, output.data(), ws);
+        return loss(output.data());
+    }
+    virtual void objective_batch(T_e** params, T_e* values, int n){
+        constexpr int tile = T_model::population_tile;
+        const int n_tiles = (n + tile - 1) / tile;
+        tbb::parallel_for(0, n_tiles, [&](int t){
+            const int first = t * tile;
+            const int n_tile = std::min(tile, n - first);
+            auto& output = outputs_.local();
+            output.resize(tile * T_model::deduce_out_size());
+            std::array<T_e*, tile> out_ptrs;
+            for(int i=0; i<n_tile; i++)
+                out_ptrs[i] = output.data() + i * T_model::deduce_out_size();
+            T_e* ws = etna::workspace<T_e>::local().reserve(T_model::deduce_population_workspace_size());
+            model_.feed_population(params + first, n_tile, input_, out_ptrs.data(), ws);
+            for(int i=0; i<n_tile; i++)
+                values[first + i] = loss(out_ptrs[i]);
+        });
+    }
+    // a tile of networks shares each pass over the input
+    virtual bool batched(){
+        return true;
+    }
+    virtual std::string to_string(){
+        return "neuroevolution system";
+    }
+};
+
+}; // end of zagros namespace
+}; // end of rocky namespace
+#endif
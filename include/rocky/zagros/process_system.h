@@ -0,0 +1,493 @@
+/*
+    Copyright (C) 2022 Amirabbas Asadi , All Rights Reserved
+    distributed under Apache-2.0 license
+*/
+#ifndef ROCKY_ZAGROS_PROCESS_SYSTEM_GUARD
+#define ROCKY_ZAGROS_PROCESS_SYSTEM_GUARD
+#include<vector>
+#include<deque>
+#include<string>
+#include<chrono>
+#include<thread>
+#include<atomic>
+#include<limits>
+#include<numeric>
+#include<cerrno>
+#include<cstdint>
+#include<cstring>
+#include<ctime>
+#include<functional>
+
+#include<fcntl.h>
+#include<poll.h>
+#include<signal.h>
+#include<pthread.h>
+#include<spawn.h>
+#include<unistd.h>
+#include<sys/wait.h>
+
+#include<tbb/concurrent_queue.h>
+
+#include<rocky/zagros/system.h>
+
+extern char** environ;
+
+namespace rocky{
+namespace zagros{
+
+/**
+ * @brief helpers for objective worker processes
+ *
+ * A worker reads requests from its stdin and writes responses to its stdout
+ * until stdin is closed. All numbers use the native byte order.
+ * - request: int32 n, int32 dim, followed by n x dim float64 parameters
+ * - response: n float64 objective values
+ */
+class objective_worker{
+public:
+    typedef std::int32_t header_type;
+    typedef double value_type;
+
+    static bool read_exact(int fd, void* buffer, size_t size){
+        char* ptr = static_cast<char*>(buffer);
+        while(size > 0){
+            ssize_t n = ::read(fd, ptr, size);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+                return false;
+            ptr += n;
+            size -= n;
+        }
+        return true;
+    }
+    static bool write_exact(int fd, const void* buffer, size_t size){
+        const char* ptr = static_cast<const char*>(buffer);
+        while(size > 0){
+            ssize_t n = ::write(fd, ptr, size);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+                return false;
+            ptr += n;
+            size -= n;
+        }
+        return true;
+    }
+    /**
+     * @brief serve the requests of a process_system on stdin and stdout
+     *
+     * @param objective objective function taking a solution and its dimension
+     * @return int exit code of the worker
+     */
+    static int serve(const std::function<value_type(const value_type*, int)>& objective){
+        std::vector<value_type> params;
+        std::vector<value_type> values;
+        header_type header[2];
+        while(read_exact(STDIN_FILENO, header, sizeof(header))){
+            const int n = header[0];
+            const int dim = header[1];
+            params.resize(static_cast<size_t>(n) * dim);
+            values.resize(n);
+            if(!read_exact(STDIN_FILENO, params.data(), params.size() * sizeof(value_type)))
+                return 1;
+            for(int i=0; i<n; i++)
+                values[i] = objective(params.data() + static_cast<size_t>(i) * dim, dim);
+            if(!write_exact(STDOUT_FILENO, values.data(), values.size() * sizeof(value_type)))
+                return 1;
+        }
+        return 0;
+    }
+};
+
+/**
+ * @brief a system evaluated by a pool of local worker processes
+ *
+ * Solutions are sent to the workers in batches over pipes. Each worker can have
+ * several batches in flight so that it never waits for the optimizer between two
+ * batches. A worker that exceeds the timeout on a batch, exits or breaks the
+ * protocol is killed and restarted and its unfinished batches are sent again.
+ * Batches that fail too many times get the maximum value of T_e.
+ * Concurrent callers check out disjoint subsets of the workers.
+ */
+template<typename T_e>
+class process_system: public system<T_e>{
+protected:
+    typedef std::chrono::steady_clock clock_type;
+    typedef objective_worker::header_type header_type;
+    typedef objective_worker::value_type value_type;
+
+    struct worker_process{
+        pid_t pid = -1;
+        // stdin of the worker
+        int to_worker = -1;
+        // stdout of the worker
+        int from_worker = -1;
+        // encoded requests that are not written yet
+        std::vector<char> out_buffer;
+        size_t out_position = 0;
+        // partial responses
+        std::vector<char> in_buffer;
+        // batches sent to the worker in order
+        std::deque<int> in_flight;
+        // when the worker started the oldest batch in flight
+        clock_type::time_point head_start;
+    };
+    struct batch{
+        int begin;
+        int end;
+        int attempts;
+    };
+
+    // command line of the workers
+    std::vector<std::string> command_;
+    int dim_;
+    // maximum number of solutions in a batch
+    int batch_size_;
+    // maximum number of batches in flight per worker
+    int depth_;
+    // maximum time for evaluating a batch
+    int timeout_ms_;
+    // maximum number of attempts for a batch
+    int max_attempts_;
+    T_e lower_bound_;
+    T_e upper_bound_;
+    std::vector<worker_process> workers_;
+    // workers that are not used by any caller
+    tbb::concurrent_bounded_queue<int> idle_;
+    std::atomic<long> n_restarts_{0};
+
+    bool spawn(worker_process& w){
+        int to_pipe[2], from_pipe[2];
+        if(pipe2(to_pipe, O_CLOEXEC) != 0)
+            return false;
+        if(pipe2(from_pipe, O_CLOEXEC) != 0){
+            close(to_pipe[0]);
+            close(to_pipe[1]);
+            return false;
+        }
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, to_pipe[0], STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, from_pipe[1], STDOUT_FILENO);
+        std::vector<char*> argv;
+        for(auto& arg: command_)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        int status = posix_spawnp(&w.pid, argv[0], &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(to_pipe[0]);
+        close(from_pipe[1]);
+        if(status != 0){
+            spdlog::error("failed to start objective worker {} : {}", command_[0], std::strerror(status));
+            close(to_pipe[1]);
+            close(from_pipe[0]);
+            w.pid = -1;
+            return false;
+        }
+        w.to_worker = to_pipe[1];
+        w.from_worker = from_pipe[0];
+        fcntl(w.to_worker, F_SETFL, fcntl(w.to_worker, F_GETFL) | O_NONBLOCK);
+        fcntl(w.from_worker, F_SETFL, fcntl(w.from_worker, F_GETFL) | O_NONBLOCK);
+        w.out_buffer.clear();
+        w.out_position = 0;
+        w.in_buffer.clear();
+        w.in_flight.clear();
+        return true;
+    }
+    // stop a worker, a graceful stop closes its stdin and waits for a while before killing it
+    void terminate(worker_process& w, bool graceful){
+        if(w.pid < 0)
+            return;
+        close(w.to_worker);
+        close(w.from_worker);
+        w.to_worker = w.from_worker = -1;
+        bool exited = false;
+        if(graceful){
+            auto deadline = clock_type::now() + std::chrono::milliseconds(timeout_ms_);
+            while(!exited && clock_type::now() < deadline){
+                exited = waitpid(w.pid, nullptr, WNOHANG) == w.pid;
+                if(!exited)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        if(!exited){
+            kill(w.pid, SIGKILL);
+            waitpid(w.pid, nullptr, 0);
+        }
+        w.pid = -1;
+    }
+    // append a batch to the requests of a worker
+    void encode(T_e** params, const batch& b, worker_process& w){
+        header_type header[2] = {static_cast<header_type>(b.end - b.begin), static_cast<header_type>(dim_)};
+        size_t offset = w.out_buffer.size();
+        w.out_buffer.resize(offset + sizeof(header) + sizeof(value_type) * dim_ * (b.end - b.begin));
+        std::memcpy(w.out_buffer.data() + offset, header, sizeof(header));
+        value_type* payload = reinterpret_cast<value_type*>(w.out_buffer.data() + offset + sizeof(header));
+        for(int p=b.begin; p<b.end; p++)
+            for(int i=0; i<dim_; i++)
+                *(payload++) = static_cast<value_type>(params[p][i]);
+    }
+    /**
+     * @brief block SIGPIPE in the calling thread during its lifetime
+     * a dead worker must not kill the optimizer while writing to its pipe, the
+     * signal raised by such a write is discarded and the write fails with EPIPE.
+     * the signal handling of the process is not changed
+     */
+    class sigpipe_guard{
+        sigset_t pipe_set_;
+        sigset_t old_set_;
+        bool was_pending_;
+
+        static bool pending(){
+            sigset_t pending_set;
+            sigpending(&pending_set);
+            return sigismember(&pending_set, SIGPIPE);
+        }
+
+    public:
+        sigpipe_guard(){
+            sigemptyset(&pipe_set_);
+            sigaddset(&pipe_set_, SIGPIPE);
+            was_pending_ = pending();
+            pthread_sigmask(SIG_BLOCK, &pipe_set_, &old_set_);
+        }
+        ~sigpipe_guard(){
+            const int saved_errno = errno;
+            if(!was_pending_ && pending()){
+                const timespec no_wait{0, 0};
+                while(sigtimedwait(&pipe_set_, nullptr, &no_wait) < 0 && errno == EINTR);
+            }
+            pthread_sigmask(SIG_SETMASK, &old_set_, nullptr);
+            errno = saved_errno;
+        }
+    };
+    // write pending requests without blocking
+    bool flush(worker_process& w){
+        sigpipe_guard guard;
+        while(w.out_position < w.out_buffer.size()){
+            ssize_t n = ::write(w.to_worker, w.out_buffer.data() + w.out_position, w.out_buffer.size() - w.out_position);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return true;
+            if(n <= 0)
+                return false;
+            w.out_position += n;
+        }
+        w.out_buffer.clear();
+        w.out_position = 0;
+        return true;
+    }
+    // read available responses and decode the finished batches
+    bool receive(worker_process& w, T_e* values, std::vector<batch>& batches, int& remaining){
+        char buffer[1 << 14];
+        while(true){
+            ssize_t n = ::read(w.from_worker, buffer, sizeof(buffer));
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            // the worker exited or failed
+            if(n <= 0)
+                return false;
+            w.in_buffer.insert(w.in_buffer.end(), buffer, buffer + n);
+        }
+        size_t consumed = 0;
+        while(!w.in_flight.empty()){
+            const batch& b = batches[w.in_flight.front()];
+            size_t size = sizeof(value_type) * (b.end - b.begin);
+            if(w.in_buffer.size() - consumed < size)
+                break;
+            const value_type* response = reinterpret_cast<const value_type*>(w.in_buffer.data() + consumed);
+            for(int p=b.begin; p<b.end; p++)
+                values[p] = static_cast<T_e>(response[p - b.begin]);
+            consumed += size;
+            w.in_flight.pop_front();
+            w.head_start = clock_type::now();
+            remaining--;
+        }
+        w.in_buffer.erase(w.in_buffer.begin(), w.in_buffer.begin() + consumed);
+        // a worker must not send more than requested
+        return !(w.in_flight.empty() && !w.in_buffer.empty());
+    }
+    // restart a failed worker and reschedule its batches
+    void recover(worker_process& w, T_e* values, std::vector<batch>& batches, std::deque<int>& pending, int& remaining){
+        for(auto it=w.in_flight.rbegin(); it!=w.in_flight.rend(); ++it){
+            batch& b = batches[*it];
+            if(++b.attempts < max_attempts_){
+                pending.push_front(*it);
+                continue;
+            }
+            spdlog::error("objective workers failed to evaluate a batch {} times", b.attempts);
+            std::fill(values + b.begin, values + b.end, std::numeric_limits<T_e>::max());
+            remaining--;
+        }
+        w.in_flight.clear();
+        terminate(w, false);
+        n_restarts_++;
+        spawn(w);
+    }
+    long elapsed_ms(const clock_type::time_point& start){
+        return std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::now() - start).count();
+    }
+    /**
+     * @brief evaluate batches with a set of checked out workers
+     *
+     * @param params pointers to the solutions
+     * @param values destination of the objective values
+     * @param batches batches of the solutions
+     * @param ids indices of the workers
+     */
+    void dispatch(T_e** params, T_e* values, std::vector<batch>& batches, const std::vector<int>& ids){
+        std::deque<int> pending(batches.size());
+        std::iota(pending.begin(), pending.end(), 0);
+        int remaining = batches.size();
+        std::vector<pollfd> fds;
+        std::vector<int> owners;
+        while(remaining > 0){
+            // keep every worker busy with up to depth batches
+            bool alive = false;
+            for(int id: ids){
+                auto& w = workers_[id];
+                if(w.pid < 0 && !spawn(w))
+                    continue;
+                alive = true;
+                while(!pending.empty() && static_cast<int>(w.in_flight.size()) < depth_){
+                    if(w.in_flight.empty())
+                        w.head_start = clock_type::now();
+                    encode(params, batches[pending.front()], w);
+                    w.in_flight.push_back(pending.front());
+                    pending.pop_front();
+                }
+            }
+            if(!alive){
+                spdlog::error("no objective worker is running");
+                for(int b: pending)
+                    std::fill(values + batches[b].begin, values + batches[b].end, std::numeric_limits<T_e>::max());
+                return;
+            }
+            // wait for the workers
+            fds.clear();
+            owners.clear();
+            long wait_ms = timeout_ms_;
+            for(int id: ids){
+                auto& w = workers_[id];
+                if(w.in_flight.empty())
+                    continue;
+                fds.push_back({w.from_worker, POLLIN, 0});
+                owners.push_back(id);
+                if(w.out_position < w.out_buffer.size()){
+                    fds.push_back({w.to_worker, POLLOUT, 0});
+                    owners.push_back(id);
+                }
+                wait_ms = std::min(wait_ms, std::max(timeout_ms_ - elapsed_ms(w.head_start), 0L));
+            }
+            if(poll(fds.data(), fds.size(), static_cast<int>(wait_ms)) < 0 && errno != EINTR){
+                spdlog::error("polling objective workers failed : {}", std::strerror(errno));
+                continue;
+            }
+            std::vector<bool> failed(workers_.size(), false);
+            for(int f=0; f<fds.size(); f++){
+                auto& w = workers_[owners[f]];
+                if(fds[f].revents == 0 || failed[owners[f]])
+                    continue;
+                bool ok = (fds[f].fd == w.to_worker) ? flush(w) : receive(w, values, batches, remaining);
+                if(!ok){
+                    spdlog::warn("objective worker {} failed, restarting", w.pid);
+                    failed[owners[f]] = true;
+                    recover(w, values, batches, pending, remaining);
+                }
+            }
+            // restart the workers that exceeded the timeout
+            for(int id: ids){
+                auto& w = workers_[id];
+                if(failed[id] || w.in_flight.empty() || elapsed_ms(w.head_start) <= timeout_ms_)
+                    continue;
+                spdlog::warn("objective worker {} timed out, restarting", w.pid);
+                recover(w, values, batches, pending, remaining);
+            }
+        }
+    }
+
+public:
+    /**
+     * @param command program and arguments of the workers
+     * @param dim dimension of the solutions
+     * @param n_workers number of worker processes, 0 uses the number of threads
+     * @param batch_size maximum number of solutions sent in one request
+     * @param depth maximum number of batches in flight per worker
+     * @param timeout_ms maximum time for evaluating a batch before restarting the worker
+     * @param max_attempts maximum number of attempts for a batch
+     */
+    process_system(const std::vector<std::string>& command, int dim, int n_workers=0, int batch_size=8, int depth=2,
+                   int timeout_ms=10000, int max_attempts=3, T_e lower_bound=-1.0, T_e upper_bound=1.0){
+        this->command_ = command;
+        this->dim_ = dim;
+        this->batch_size_ = std::max(batch_size, 1);
+        this->depth_ = std::max(depth, 1);
+        this->timeout_ms_ = timeout_ms;
+        this->max_attempts_ = std::max(max_attempts, 1);
+        this->lower_bound_ = lower_bound;
+        this->upper_bound_ = upper_bound;
+        if(n_workers <= 0)
+            n_workers = tbb::this_task_arena::max_concurrency();
+        workers_.resize(n_workers);
+        for(int id=0; id<n_workers; id++){
+            spawn(workers_[id]);
+            idle_.push(id);
+        }
+    }
+    virtual ~process_system(){
+        for(auto& w: workers_)
+            terminate(w, true);
+    }
+    int n_workers() const{
+        return workers_.size();
+    }
+    // number of restarted workers
+    long n_restarts() const{
+        return n_restarts_;
+    }
+    virtual T_e objective(T_e* params){
+        T_e value;
+        objective_batch(&params, &value, 1);
+        return value;
+    }
+    virtual void objective_batch(T_e** params, T_e* values, int n){
+        if(n <= 0)
+            return;
+        std::vector<batch> batches;
+        for(int b=0; b<n; b+=batch_size_)
+            batches.push_back({b, std::min(b + batch_size_, n), 0});
+        // check out at least one worker and at most one per batch
+        std::vector<int> ids;
+        int id;
+        idle_.pop(id);
+        ids.push_back(id);
+        while(ids.size() < batches.size() && idle_.try_pop(id))
+            ids.push_back(id);
+        dispatch(params, values, batches, ids);
+        for(int id: ids)
+            idle_.push(id);
+    }
+    // workers always compute the exact values
+    virtual void objective_batch_bounded(T_e** params, T_e* values, int n, const T_e* thresholds){
+        objective_batch(params, values, n);
+    }
+    // the protocol has no fidelity, workers always run at full fidelity
+    virtual void objective_batch_fidelity(T_e** params, T_e* values, int n, T_e fidelity){
+        objective_batch(params, values, n);
+    }
+    // a batch is split among the workers
+    virtual bool batched(){ return true; }
+    virtual T_e lower_bound(){ return lower_bound_; }
+    virtual T_e upper_bound(){ return upper_bound_; }
+    virtual std::string to_string(){
+        return "process system(" + command_[0] + ")";
+    }
+};
+
+}; // end of zagros namespace
+}; // end of rocky namespace
+#endif
@@ -0,0 +1,625 @@
+/*
+    Copyright (C) 2022 Amirabbas Asadi , All Rights Reserved
+    distributed under Apache-2.0 license
+*/
+#ifndef ROCKY_ZAGROS_CMAES_STRATEGY
+#define ROCKY_ZAGROS_CMAES_STRATEGY
+
+#include <rocky/zagros/strategies/strategy.h>
+
+#include <Eigen/Core>
+#include <Eigen/Eigenvalues>
+
+
+namespace rocky{
+namespace zagros{
+
+/**
+ * @brief restart policies of CMA-ES
+ * none: restart with the same population size
+ * ipop: double the population size after each restart
+ * bipop: alternate between a growing population and small populations with smaller step sizes
+ */
+enum class cmaes_restart {none, ipop, bipop};
+
+/**
+ * @brief Base class for CMA-ES variants
+ *
+ * Handles the population, step size adaptation, recombination and restarts.
+ * Derived classes provide the covariance model by mapping standard normal
+ * variates z to the deviations y and adapting the model after selection.
+ * All buffers are allocated once for the largest population that fits in
+ * the population container.
+ */
+template<typename T_e, int T_dim>
+class basic_cmaes: public search_strategy<T_e, T_dim>{
+public:
+    typedef Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> eigen_matrix;
+    typedef Eigen::Map<Eigen::Matrix<T_e, 1, T_dim, Eigen::RowMajor>> eigen_particle;
+    typedef Eigen::Matrix<T_e, Eigen::Dynamic, 1> dense_vector;
+    typedef Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic> dense_matrix;
+
+    /**
+     * @brief default population size for a given dimension
+     *
+     * @param dim problem dimension
+     * @return * int
+     */
+    static int default_population(int dim){
+        return 4 + static_cast<int>(3.0 * std::log(static_cast<double>(dim)));
+    }
+
+protected:
+    // system
+    system<T_e>* problem_;
+    // main container
+    basic_scontainer<T_e, T_dim>* main_container_;
+    // candidates of each generation, its size bounds the population growth
+    basic_scontainer<T_e, T_dim>* population_;
+    // restart policy
+    cmaes_restart restart_;
+    // initial step size relative to the search range
+    T_e sigma_scale_;
+
+    // population size
+    int lambda_;
+    // number of selected candidates
+    int mu_;
+    // recombination weights
+    dense_vector weights_;
+    // variance effective selection mass
+    T_e mu_eff_;
+    // learning rates and damping
+    T_e c_sigma_;
+    T_e d_sigma_;
+    T_e c_c_;
+    T_e c_1_;
+    T_e c_mu_;
+    // expected norm of a standard normal vector
+    T_e chi_n_;
+
+    // mean of the distribution
+    dense_vector mean_;
+    // step size
+    T_e sigma_;
+    // step size at the start of the current run
+    T_e sigma0_;
+    // evolution path of the step size
+    dense_vector p_sigma_;
+    // C^(-1/2) * y_w
+    dense_vector whitened_;
+    // weighted mean of the selected z and y
+    dense_vector z_w_;
+    dense_vector y_w_;
+    // number of generations in the current run
+    int generation_;
+
+    // standard normal variates, capacity x dim
+    std::vector<T_e> z_mem_;
+    // deviations from the mean before scaling by the step size, capacity x dim
+    std::vector<T_e> y_mem_;
+    // population indices, the first mu are sorted by their values
+    std::vector<int> ranks_;
+
+    // whether a run has been started for the current block
+    bool initialized_;
+    // restart bookkeeping
+    int n_restarts_;
+    int default_lambda_;
+    int large_lambda_;
+    long evals_large_;
+    long evals_small_;
+    bool small_regime_;
+    T_e run_best_;
+    int stall_generations_;
+
+    T_e rand_uniform(){
+        static std::uniform_real_distribution<T_e> dist(0.0, 1.0);
+        return dist(rocky::utils::random::prng());
+    }
+    int capacity() const{
+        return population_->n_particles();
+    }
+    /**
+     * @brief learning rates of the covariance model
+     *
+     * @return * void
+     */
+    virtual void set_learning_rates(){
+        const T_e n = T_dim;
+        c_c_ = (4.0 + mu_eff_ / n) / (n + 4.0 + 2.0 * mu_eff_ / n);
+        c_1_ = 2.0 / ((n + 1.3) * (n + 1.3) + mu_eff_);
+        c_mu_ = std::min<T_e>(1.0 - c_1_, 2.0 * (mu_eff_ - 2.0 + 1.0 / mu_eff_) / ((n + 2.0) * (n + 2.0) + mu_eff_));
+    }
+    /**
+     * @brief population size, weights and learning rates
+     *
+     * @param lambda population size
+     * @return * void
+     */
+    void set_parameters(int lambda){
+        lambda_ = std::clamp(lambda, 2, capacity());
+        mu_ = std::max(lambda_ / 2, 1);
+        weights_.resize(mu_);
+        for(int i=0; i<mu_; i++)
+            weights_[i] = std::log((lambda_ + 1.0) / 2.0) - std::log(i + 1.0);
+        weights_ /= weights_.sum();
+        mu_eff_ = 1.0 / weights_.squaredNorm();
+
+        const T_e n = T_dim;
+        c_sigma_ = (mu_eff_ + 2.0) / (n + mu_eff_ + 5.0);
+        d_sigma_ = 1.0 + 2.0 * std::max<T_e>(0.0, std::sqrt((mu_eff_ - 1.0) / (n + 1.0)) - 1.0) + c_sigma_;
+        chi_n_ = std::sqrt(n) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+        set_learning_rates();
+    }
+    /**
+     * @brief reset the covariance model at the start of a run
+     *
+     * @return * void
+     */
+    virtual void init_distribution() = 0;
+    /**
+     * @brief map z to the deviations y for the first lambda_ rows
+     *
+     * @return * void
+     */
+    virtual void sample_deviations() = 0;
+    /**
+     * @brief compute whitened_ = C^(-1/2) * y_w
+     *
+     * @return * void
+     */
+    virtual void whiten_step() = 0;
+    /**
+     * @brief adapt the covariance model after selection
+     *
+     * @param h_sigma whether the step size path is not stalled
+     * @return * void
+     */
+    virtual void adapt_covariance(bool h_sigma) = 0;
+    /**
+     * @brief largest and smallest standard deviation along the principal axes
+     *
+     * @return * std::pair<T_e, T_e>
+     */
+    virtual std::pair<T_e, T_e> axis_range() = 0;
+    /**
+     * @brief start a new run
+     *
+     * @param lambda population size
+     * @param sigma_scale step size relative to the search range
+     * @param from_main start from the best solution of the main container
+     * @return * void
+     */
+    void start(int lambda, T_e sigma_scale, bool from_main){
+        set_parameters(lambda);
+        auto best = main_container_->best_min_index();
+        T_e range = 0.0;
+        for(int i=0; i<T_dim; i++){
+            T_e lb = problem_->lower_bound(i);
+            T_e ub = problem_->upper_bound(i);
+            range += ub - lb;
+            if(!from_main || best.first == std::numeric_limits<T_e>::max())
+                mean_[i] = lb + rand_uniform() * (ub - lb);
+            else
+                mean_[i] = main_container_->particle(best.second)[i];
+        }
+        sigma0_ = sigma_scale * range / T_dim;
+        sigma_ = sigma0_;
+        p_sigma_.setZero();
+        generation_ = 0;
+        run_best_ = std::numeric_limits<T_e>::max();
+        stall_generations_ = 0;
+        init_distribution();
+    }
+    /**
+     * @brief start a new run according to the restart policy
+     *
+     * @return * void
+     */
+    void restart(){
+        n_restarts_++;
+        if(restart_ == cmaes_restart::none){
+            start(lambda_, sigma_scale_, false);
+            return;
+        }
+        if(restart_ == cmaes_restart::bipop && evals_small_ < evals_large_){
+            // small population with a smaller step size
+            T_e u = rand_uniform();
+            int lambda = static_cast<int>(default_lambda_ * std::pow(0.5 * large_lambda_ / default_lambda_, u * u));
+            small_regime_ = true;
+            start(std::max(lambda, default_lambda_), sigma_scale_ * std::pow(10.0, -2.0 * u), false);
+            return;
+        }
+        large_lambda_ = std::min(2 * large_lambda_, capacity());
+        small_regime_ = false;
+        start(large_lambda_, sigma_scale_, false);
+    }
+    /**
+     * @brief check the termination criteria of the current run
+     *
+     * @return true if the run should be restarted
+     */
+    bool should_restart(){
+        if(!std::isfinite(sigma_))
+            return true;
+        T_e gen_best = population_->values[ranks_[0]];
+        T_e gen_worst = *std::max_element(population_->values.begin(), population_->values.begin() + lambda_);
+        if(gen_best < run_best_ - 1e-12 * std::abs(run_best_)){
+            run_best_ = gen_best;
+            stall_generations_ = 0;
+        }
+        else
+            stall_generations_++;
+        // no improvement for a long time
+        if(stall_generations_ > 10 + (30 * T_dim) / lambda_)
+            return true;
+        // flat fitness within the population
+        if(generation_ > 1 && gen_worst - gen_best <= 1e-12 * std::max<T_e>(1.0, std::abs(gen_best)))
+            return true;
+        auto [max_axis, min_axis] = axis_range();
+        // the distribution is too narrow or ill-conditioned
+        if(sigma_ * max_axis < 1e-12 * sigma0_)
+            return true;
+        if(max_axis > 1e7 * min_axis)
+            return true;
+        return false;
+    }
+    /**
+     * @brief sample the population of the current generation
+     *
+     * @return * void
+     */
+    void sample_population(){
+        tbb::parallel_for(tbb::blocked_range<int>(0, lambda_), [&](const tbb::blocked_range<int>& r){
+            rocky::utils::random::normal<T_e>(this->z_mem_.data() + r.begin() * T_dim, (r.end() - r.begin()) * T_dim);
+        });
+        sample_deviations();
+        eigen_matrix y_mat(y_mem_.data(), lambda_, T_dim);
+        tbb::parallel_for(0, lambda_, [&](int p){
+            eigen_particle x(this->population_->particle(p));
+            x = this->mean_.transpose() + this->sigma_ * y_mat.row(p);
+        });
+    }
+    /**
+     * @brief recombination, step size and covariance adaptation
+     *
+     * @return * void
+     */
+    void update_distribution(){
+        std::iota(ranks_.begin(), ranks_.begin() + lambda_, 0);
+        std::partial_sort(ranks_.begin(), ranks_.begin() + mu_, ranks_.begin() + lambda_, [this](int x, int y){
+            return this->population_->values[x] < this->population_->values[y];
+        });
+        eigen_matrix z_mat(z_mem_.data(), lambda_, T_dim);
+        eigen_matrix y_mat(y_mem_.data(), lambda_, T_dim);
+        z_w_.setZero();
+        y_w_.setZero();
+        for(int i=0; i<mu_; i++){
+            z_w_ += weights_[i] * z_mat.row(ranks_[i]).transpose();
+            y_w_ += weights_[i] * y_mat.row(ranks_[i]).transpose();
+        }
+        mean_ += sigma_ * y_w_;
+        generation_++;
+
+        // cumulation for the step size
+        whiten_step();
+        p_sigma_ = (1.0 - c_sigma_) * p_sigma_ + std::sqrt(c_sigma_ * (2.0 - c_sigma_) * mu_eff_) * whitened_;
+        T_e p_sigma_norm = p_sigma_.norm();
+        T_e correction = std::sqrt(1.0 - std::pow(1.0 - c_sigma_, 2.0 * generation_));
+        bool h_sigma = p_sigma_norm / correction < (1.4 + 2.0 / (T_dim + 1.0)) * chi_n_;
+
+        adapt_covariance(h_sigma);
+        adapt_step_size(p_sigma_norm);
+    }
+    /**
+     * @brief cumulative step size adaptation
+     *
+     * @param p_sigma_norm norm of the step size path
+     * @return * void
+     */
+    virtual void adapt_step_size(T_e p_sigma_norm){
+        sigma_ *= std::exp(std::min<T_e>((c_sigma_ / d_sigma_) * (p_sigma_norm / chi_n_ - 1.0), 1.0));
+    }
+
+public:
+    basic_cmaes(system<T_e>* problem, basic_scontainer<T_e, T_dim>* main_container, basic_scontainer<T_e, T_dim>* population, cmaes_restart restart=cmaes_restart::ipop, T_e sigma_scale=0.3){
+        this->problem_ = problem;
+        this->main_container_ = main_container;
+        this->population_ = population;
+        this->restart_ = restart;
+        this->sigma_scale_ = sigma_scale;
+        this->default_lambda_ = std::min(default_population(T_dim), population->n_particles());
+        mean_.resize(T_dim);
+        p_sigma_.resize(T_dim);
+        whitened_.resize(T_dim);
+        z_w_.resize(T_dim);
+        y_w_.resize(T_dim);
+        z_mem_.resize(population->n_particles() * T_dim);
+        y_mem_.resize(population->n_particles() * T_dim);
+        ranks_.resize(population->n_particles());
+        this->initialized_ = false;
+        this->n_restarts_ = 0;
+    }
+    // a new block starts a new sequence of runs from the best solution of the main container
+    virtual void reset(){
+        this->initialized_ = false;
+    }
+    int n_restarts() const{
+        return n_restarts_;
+    }
+    int population_size() const{
+        return lambda_;
+    }
+    T_e step_size() const{
+        return sigma_;
+    }
+    virtual void apply(){
+        if(!initialized_){
+            large_lambda_ = default_lambda_;
+            evals_large_ = 0;
+            evals_small_ = 0;
+            small_regime_ = false;
+            start(default_lambda_, sigma_scale_, true);
+            initialized_ = true;
+        }
+        sample_population();
+        // evaluate the whole generation at once, the unused part of the container never replaces a solution
+        population_->evaluate_and_update(problem_, 0, lambda_);
+        std::fill(population_->values.begin() + lambda_, population_->values.end(), std::numeric_limits<T_e>::max());
+        if(small_regime_)
+            evals_small_ += lambda_;
+        else
+            evals_large_ += lambda_;
+        update_distribution();
+        main_container_->replace_with(population_);
+        if(should_restart())
+            restart();
+    }
+};
+
+/**
+ * @brief CMA-ES with a full covariance matrix
+ *
+ * The covariance is updated with a rank-one and a rank-mu update (SYRK) and
+ * its eigendecomposition is only recomputed every few generations.
+ */
+template<typename T_e, int T_dim>
+class cmaes_strategy: public basic_cmaes<T_e, T_dim>{
+protected:
+    typedef typename basic_cmaes<T_e, T_dim>::dense_vector dense_vector;
+    typedef typename basic_cmaes<T_e, T_dim>::dense_matrix dense_matrix;
+    typedef typename basic_cmaes<T_e, T_dim>::eigen_matrix eigen_matrix;
+
+    // covariance matrix, only the lower triangle is maintained
+    dense_matrix cov_;
+    // principal axes
+    dense_matrix axes_;
+    // standard deviations along the principal axes
+    dense_vector scales_;
+    // (axes * diag(scales))^T, maps a row of z to a row of y
+    dense_matrix transform_;
+    // evolution path of the covariance
+    dense_vector p_c_;
+    // weighted deviations of the selected candidates, capacity/2 x dim
+    Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> selected_;
+    Eigen::SelfAdjointEigenSolver<dense_matrix> eigen_solver_;
+    // number of generations between two eigendecompositions
+    int eigen_period_;
+    // generation of the last eigendecomposition
+    int last_eigen_;
+
+    void decompose(){
+        eigen_solver_.compute(cov_);
+        if(eigen_solver_.info() != Eigen::Success){
+            this->sigma_ = std::numeric_limits<T_e>::infinity();
+            return;
+        }
+        axes_ = eigen_solver_.eigenvectors();
+        scales_ = eigen_solver_.eigenvalues().cwiseMax(std::numeric_limits<T_e>::min()).cwiseSqrt();
+        transform_.noalias() = (axes_ * scales_.asDiagonal()).transpose();
+        last_eigen_ = this->generation_;
+    }
+    virtual void init_distribution(){
+        cov_.setIdentity();
+        axes_.setIdentity();
+        scales_.setOnes();
+        transform_.setIdentity();
+        p_c_.setZero();
+        eigen_period_ = std::max(1, static_cast<int>(this->lambda_ / ((this->c_1_ + this->c_mu_) * T_dim * 10.0)));
+        last_eigen_ = 0;
+    }
+    virtual void sample_deviations(){
+        eigen_matrix z_mat(this->z_mem_.data(), this->lambda_, T_dim);
+        eigen_matrix y_mat(this->y_mem_.data(), this->lambda_, T_dim);
+        y_mat.noalias() = z_mat * transform_;
+    }
+    virtual void whiten_step(){
+        this->whitened_.noalias() = axes_ * this->z_w_;
+    }
+    virtual void adapt_covariance(bool h_sigma){
+        const T_e c_c = this->c_c_;
+        p_c_ = (1.0 - c_c) * p_c_ + (h_sigma ? std::sqrt(c_c * (2.0 - c_c) * this->mu_eff_) : 0.0) * this->y_w_;
+        eigen_matrix y_mat(this->y_mem_.data(), this->lambda_, T_dim);
+        for(int i=0; i<this->mu_; i++)
+            selected_.row(i) = std::sqrt(this->weights_[i]) * y_mat.row(this->ranks_[i]);
+        T_e decay = 1.0 - this->c_1_ - this->c_mu_ + (h_sigma ? 0.0 : this->c_1_ * c_c * (2.0 - c_c));
+        cov_ *= decay;
+        cov_.template selfadjointView<Eigen::Lower>().rankUpdate(p_c_, this->c_1_);
+        cov_.template selfadjointView<Eigen::Lower>().rankUpdate(selected_.topRows(this->mu_).transpose(), this->c_mu_);
+        if(this->generation_ - last_eigen_ >= eigen_period_)
+            decompose();
+    }
+    virtual std::pair<T_e, T_e> axis_range(){
+        return std::make_pair(scales_.maxCoeff(), scales_.minCoeff());
+    }
+
+public:
+    /**
+     * @param problem objective system
+     * @param main_container solutions receiving the best candidates
+     * @param population candidates of each generation, its size is the largest allowed population
+     * @param restart restart policy
+     * @param sigma_scale initial step size relative to the search range
+     */
+    cmaes_strategy(system<T_e>* problem, basic_scontainer<T_e, T_dim>* main_container, basic_scontainer<T_e, T_dim>* population, cmaes_restart restart=cmaes_restart::ipop, T_e sigma_scale=0.3)
+    :basic_cmaes<T_e, T_dim>(problem, main_container, population, restart, sigma_scale){
+        cov_.resize(T_dim, T_dim);
+        axes_.resize(T_dim, T_dim);
+        scales_.resize(T_dim);
+        transform_.resize(T_dim, T_dim);
+        p_c_.resize(T_dim);
+        selected_.resize(std::max(population->n_particles() / 2, 1), T_dim);
+        eigen_solver_ = Eigen::SelfAdjointEigenSolver<dense_matrix>(T_dim);
+    }
+};
+
+/**
+ * @brief separable CMA-ES
+ *
+ * The covariance is restricted to a diagonal matrix, so sampling and
+ * adaptation cost O(lambda * d) per generation. The learning rates are
+ * increased by (d + 2) / 3 as proposed for sep-CMA-ES.
+ */
+template<typename T_e, int T_dim>
+class sep_cmaes_strategy: public basic_cmaes<T_e, T_dim>{
+protected:
+    typedef typename basic_cmaes<T_e, T_dim>::dense_vector dense_vector;
+    typedef typename basic_cmaes<T_e, T_dim>::eigen_matrix eigen_matrix;
+
+    // diagonal of the covariance matrix
+    dense_vector cov_;
+    // standard deviation of each dimension
+    dense_vector scales_;
+    // evolution path of the covariance
+    dense_vector p_c_;
+    // weighted sum of the squared deviations of the selected candidates
+    dense_vector rank_mu_;
+
+    virtual void set_learning_rates(){
+        basic_cmaes<T_e, T_dim>::set_learning_rates();
+        const T_e boost = (T_dim + 2.0) / 3.0;
+        this->c_1_ = std::min<T_e>(this->c_1_ * boost, 1.0);
+        this->c_mu_ = std::min<T_e>(1.0 - this->c_1_, this->c_mu_ * boost);
+    }
+    virtual void init_distribution(){
+        cov_.setOnes();
+        scales_.setOnes();
+        p_c_.setZero();
+    }
+    virtual void sample_deviations(){
+        eigen_matrix z_mat(this->z_mem_.data(), this->lambda_, T_dim);
+        eigen_matrix y_mat(this->y_mem_.data(), this->lambda_, T_dim);
+        tbb::parallel_for(tbb::blocked_range<int>(0, this->lambda_), [&](const tbb::blocked_range<int>& r){
+            y_mat.middleRows(r.begin(), r.end() - r.begin()).array() = z_mat.middleRows(r.begin(), r.end() - r.begin()).array().rowwise() * scales_.transpose().array();
+        });
+    }
+    virtual void whiten_step(){
+        this->whitened_ = this->z_w_;
+    }
+    virtual void adapt_covariance(bool h_sigma){
+        const T_e c_c = this->c_c_;
+        p_c_ = (1.0 - c_c) * p_c_ + (h_sigma ? std::sqrt(c_c * (2.0 - c_c) * this->mu_eff_) : 0.0) * this->y_w_;
+        eigen_matrix y_mat(this->y_mem_.data(), this->lambda_, T_dim);
+        rank_mu_.setZero();
+        for(int i=0; i<this->mu_; i++)
+            rank_mu_.array() += this->weights_[i] * y_mat.row(this->ranks_[i]).transpose().array().square();
+        T_e decay = 1.0 - this->c_1_ - this->c_mu_ + (h_sigma ? 0.0 : this->c_1_ * c_c * (2.0 - c_c));
+        cov_.array() = decay * cov_.array() + this->c_1_ * p_c_.array().square() + this->c_mu_ * rank_mu_.array();
+        scales_ = cov_.cwiseMax(std::numeric_limits<T_e>::min()).cwiseSqrt();
+    }
+    virtual std::pair<T_e, T_e> axis_range(){
+        return std::make_pair(scales_.maxCoeff(), scales_.minCoeff());
+    }
+
+public:
+    sep_cmaes_strategy(system<T_e>* problem, basic_scontainer<T_e, T_dim>* main_container, basic_scontainer<T_e, T_dim>* population, cmaes_restart restart=cmaes_restart::ipop, T_e sigma_scale=0.3)
+    :basic_cmaes<T_e, T_dim>(problem, main_container, population, restart, sigma_scale){
+        cov_.resize(T_dim);
+        scales_.resize(T_dim);
+        p_c_.resize(T_dim);
+        rank_mu_.resize(T_dim);
+    }
+};
+
+/**
+ * @brief limited-memory matrix adaptation evolution strategy (LM-MA-ES)
+ *
+ * The covariance is represented implicitly by m evolution paths. A standard
+ * normal vector z is transformed by m successive rank-one corrections
+ *  d <- (1 - c_j) * d + c_j * M_j * (M_j^T * d)
+ * which are applied to the whole population at once, so each generation
+ * costs O(lambda * d * m) time and O(d * m) memory in addition to the population.
+ */
+template<typename T_e, int T_dim>
+class lm_ma_es_strategy: public basic_cmaes<T_e, T_dim>{
+protected:
+    typedef typename basic_cmaes<T_e, T_dim>::dense_vector dense_vector;
+    typedef typename basic_cmaes<T_e, T_dim>::eigen_matrix eigen_matrix;
+
+    // number of evolution paths
+    int n_paths_;
+    // evolution paths, n_paths x dim
+    Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> paths_;
+    // learning rates of the transformation and the paths
+    dense_vector c_d_;
+    dense_vector c_path_;
+    // projections of the population on a path
+    dense_vector projections_;
+
+    virtual void set_learning_rates(){
+        const T_e n = T_dim;
+        this->c_sigma_ = std::min<T_e>(2.0 * this->lambda_ / n, 1.0);
+        this->d_sigma_ = 2.0;
+        c_d_.resize(n_paths_);
+        c_path_.resize(n_paths_);
+        for(int j=0; j<n_paths_; j++){
+            c_d_[j] = 1.0 / (std::pow(1.5, j) * n);
+            c_path_[j] = std::min<T_e>(this->lambda_ / (std::pow(4.0, j) * n), 1.0);
+        }
+    }
+    virtual void init_distribution(){
+        paths_.setZero();
+    }
+    virtual void sample_deviations(){
+        eigen_matrix z_mat(this->z_mem_.data(), this->lambda_, T_dim);
+        eigen_matrix y_mat(this->y_mem_.data(), this->lambda_, T_dim);
+        y_mat = z_mat;
+        // the first paths are the most recent, only paths that have been filled are applied
+        int n_active = std::min(this->generation_, n_paths_);
+        for(int j=0; j<n_active; j++){
+            projections_.head(this->lambda_).noalias() = y_mat * paths_.row(j).transpose();
+            y_mat *= (1.0 - c_d_[j]);
+            y_mat.noalias() += c_d_[j] * projections_.head(this->lambda_) * paths_.row(j);
+        }
+    }
+    virtual void whiten_step(){
+        this->whitened_ = this->z_w_;
+    }
+    virtual void adapt_covariance(bool h_sigma){
+        T_e scale = std::sqrt(this->mu_eff_);
+        for(int j=0; j<n_paths_; j++)
+            paths_.row(j) = (1.0 - c_path_[j]) * paths_.row(j) + std::sqrt(c_path_[j] * (2.0 - c_path_[j])) * scale * this->z_w_.transpose();
+    }
+    virtual void adapt_step_size(T_e p_sigma_norm){
+        this->sigma_ *= std::exp(std::min<T_e>((this->c_sigma_ / this->d_sigma_) * (p_sigma_norm * p_sigma_norm / T_dim - 1.0), 1.0));
+    }
+    virtual std::pair<T_e, T_e> axis_range(){
+        return std::make_pair(1.0, 1.0);
+    }
+
+public:
+    /**
+     * @param n_paths number of evolution paths, non-positive values select 4 + 3 * ln(d)
+     */
+    lm_ma_es_strategy(system<T_e>* problem, basic_scontainer<T_e, T_dim>* main_container, basic_scontainer<T_e, T_dim>* population, cmaes_restart restart=cmaes_restart::ipop, T_e sigma_scale=0.3, int n_paths=0)
+    :basic_cmaes<T_e, T_dim>(problem, main_container, population, restart, sigma_scale){
+        n_paths_ = (n_paths > 0) ? n_paths : basic_cmaes<T_e, T_dim>::default_population(T_dim);
+        paths_.resize(n_paths_, T_dim);
+        projections_.resize(population->n_particles());
+    }
+};
+
+}; // end of zagros
+}; // end of rocky
+#endif
@@ -5,6 +5,8 @@
 #ifndef ROCKY_ZAGROS_CONTAINER_MAN
 #define ROCKY_ZAGROS_CONTAINER_MAN
 
+#include <numeric>
+
 #include <rocky/zagros/strategies/strategy.h>
 
 namespace rocky{
@@ -62,6 +64,85 @@ public:
     }
 };
 
+/**
+ * @brief evaluate the solutions in a container with successive halving
+ * 
+ * All solutions are evaluated at the lowest fidelity, then only the best
+ * 1/eta of them are promoted to a fidelity eta times higher until the survivors
+ * are evaluated at full fidelity. Only full-fidelity values are committed, the
+ * eliminated solutions get the maximum value so they never replace a solution.
+ */
+template<typename T_e, int T_dim>
+class successive_halving_eval_strategy: public container_strategy<T_e, T_dim>{
+protected:
+    // problem
+    system<T_e>* problem_;
+    // destination container
+    basic_scontainer<T_e, T_dim>* container_;
+    // fidelity of the first rung
+    T_e min_fidelity_;
+    // reduction factor between the rungs
+    T_e eta_;
+    // evaluation cost in units of full-fidelity evaluations
+    double cost_;
+    std::vector<int> alive_;
+    std::vector<T_e*> batch_;
+    std::vector<T_e> values_;
+
+public:
+    /**
+     * @param problem a system implementing objective_fidelity
+     * @param cnt destination container
+     * @param min_fidelity fidelity of the first rung
+     * @param eta reduction factor, the best 1/eta solutions of each rung are promoted
+     */
+    successive_halving_eval_strategy(system<T_e>* problem, basic_scontainer<T_e, T_dim>* cnt, T_e min_fidelity, T_e eta){
+        problem_ = problem;
+        container_ = cnt;
+        min_fidelity_ = std::clamp<T_e>(min_fidelity, std::numeric_limits<T_e>::min(), 1.0);
+        eta_ = std::max<T_e>(eta, 1.0 + 1e-6);
+        cost_ = 0.0;
+    }
+    double cost() const{
+        return cost_;
+    }
+    virtual void apply(){
+        const int n = container_->n_particles();
+        alive_.resize(n);
+        std::iota(alive_.begin(), alive_.end(), 0);
+        T_e fidelity = min_fidelity_;
+        while(true){
+            const int n_alive = alive_.size();
+            batch_.resize(n_alive);
+            values_.resize(n_alive);
+            for(int i=0; i<n_alive; i++)
+                batch_[i] = container_->particle(alive_[i]);
+            if(fidelity >= 1.0)
+                break;
+            problem_->objective_batch_fidelity(batch_.data(), values_.data(), n_alive, fidelity);
+            cost_ += n_alive * fidelity;
+            // promote the best solutions of the rung
+            const int n_promoted = std::max(static_cast<int>(std::ceil(n_alive / eta_)), 1);
+            std::vector<int> order(n_alive);
+            std::iota(order.begin(), order.end(), 0);
+            std::partial_sort(order.begin(), order.begin() + n_promoted, order.end(), [this](int a, int b){
+                return this->values_[a] < this->values_[b];
+            });
+            for(int i=n_promoted; i<n_alive; i++)
+                container_->values[alive_[order[i]]] = std::numeric_limits<T_e>::max();
+            for(int i=0; i<n_promoted; i++)
+                order[i] = alive_[order[i]];
+            alive_.assign(order.begin(), order.begin() + n_promoted);
+            // the last rung is exactly at full fidelity
+            fidelity = (fidelity * eta_ > 1.0 - 1e-6) ? 1.0 : fidelity * eta_;
+        }
+        problem_->objective_batch(batch_.data(), values_.data(), alive_.size());
+        cost_ += alive_.size();
+        for(int i=0; i<alive_.size(); i++)
+            container_->values[alive_[i]] = values_[i];
+    }
+};
+
 };
 };
 
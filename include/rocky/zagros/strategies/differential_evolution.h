@@ -6,12 +6,14 @@
 #define ROCKY_ZAGROS_DE_STRATEGY
 
 #include <rocky/zagros/strategies/strategy.h>
+#include <rocky/zagros/strategies/pipeline.h>
+#include <rocky/zagros/strategies/surrogate.h>
 
 namespace rocky{
 namespace zagros{
 
 template<typename T_e, int T_dim>
-class basic_differential_evolution: public search_strategy<T_e, T_dim>{
+class basic_differential_evolution: public search_strategy<T_e, T_dim>, public candidate_operator<T_e, T_dim>, public surrogate_assisted<T_e, T_dim>{
 protected:
     system<T_e>* problem_;
     // target container
@@ -42,37 +44,340 @@ public:
         static std::uniform_real_distribution<T_e> dist(0.0, 1.0);
         return dist(rocky::utils::random::prng());
     }    
+    virtual basic_scontainer<T_e, T_dim>* target(){
+        return container_;
+    }
+    virtual void generate(T_e* candidate){
+        int parents[4];
+        this->container_->sample_n_particles(parents, 4);
+        auto& [x, a, b, c] = parents;
+        // making a copy of x
+        std::copy(this->container_->particle(x),
+                  this->container_->particle(x) + T_dim,
+                  candidate);
+        for(int d=0; d<T_dim; d++){
+            // perform crossover based on the crossover probability CR
+            if(this->rand_uniform() > this->CR_)
+                continue;
+            // apply crossover
+            candidate[d] = this->container_->particles[a][d] +
+                           this->DW_ * (this->container_->particles[b][d] -
+                                        this->container_->particles[c][d]);            
+        }
+    }
     // apply differential evolution within groups in parallel
     virtual void apply(){
         if(container_->n_particles() < 4){
             spdlog::warn("For using differential evolution the number of particles must be at least 4!");
             return;
         }
+        if(this->run_pipelined(n_crossovers_))
+            return;
         tbb::parallel_for(0, n_crossovers_, [this](int p){
-            int parents[4];
-            this->container_->sample_n_particles(parents, 4);
-            auto& [x, a, b, c] = parents;
-            // making a copy of x
-            std::copy(this->container_->particle(x),
-                      this->container_->particle(x) + T_dim,
-                      this->candidates_->particle(p));
-            for(int d=0; d<T_dim; d++){
-                // perform crossover based on the crossover probability CR
-                if(this->rand_uniform() > this->CR_)
-                    continue;
-                // apply crossover
-                this->candidates_->particles[p][d] = this->container_->particles[a][d] +
-                                                     this->DW_ * (this->container_->particles[b][d] -
-                                                                  this->container_->particles[c][d]);            
-            }
+            this->generate(this->candidates_->particle(p));
         });
         // replace improved solutions
-        candidates_->evaluate_and_update(problem_);
+        this->evaluate_candidates(problem_, candidates_, 0, n_crossovers_, container_);
         container_->replace_with(candidates_);
     }
 };
 
 
+/**
+ * @brief mutation schemes of the differential evolution engine
+ * rand_1: v = x_r1 + F * (x_r2 - x_r3)
+ * best_1: v = x_best + F * (x_r1 - x_r2)
+ * current_to_pbest_1: v = x_i + F * (x_pbest - x_i) + F * (x_r1 - x_r2)
+ */
+enum class de_mutation {rand_1, best_1, current_to_pbest_1};
+
+/**
+ * @brief adaptation of the crossover probability and differential weight
+ * fixed: the same CR and F for all trials
+ * jade: CR and F are sampled around means adapted from successful trials
+ * shade: CR and F are sampled around a history of improvement-weighted means
+ */
+enum class de_adaptation {fixed, jade, shade};
+
+/**
+ * @brief success history of self-adaptive differential evolution
+ * kept by the runtime so that it survives block changes
+ */
+template<typename T_e>
+struct de_success_history{
+    // means of the successful crossover probabilities
+    std::vector<T_e> cr;
+    // means of the successful differential weights
+    std::vector<T_e> f;
+    // next memory slot to be updated
+    int position = 0;
+    // total number of successful trials
+    long n_successes = 0;
+
+    void resize(int size, T_e cr0=0.5, T_e f0=0.5){
+        cr.assign(std::max(size, 1), cr0);
+        f.assign(std::max(size, 1), f0);
+        position = 0;
+    }
+};
+
+/**
+ * @brief differential evolution engine
+ * 
+ * Parent indices, CR and F of all trials are drawn once per generation,
+ * trial vectors are built with Eigen expressions and binomial crossover
+ * masks are generated a row at a time. Each trial competes only with its
+ * target vector (one-to-one selection).
+ */
+template<typename T_e, int T_dim>
+class adaptive_differential_evolution: public search_strategy<T_e, T_dim>, public candidate_operator<T_e, T_dim>, public surrogate_assisted<T_e, T_dim>{
+public:
+    typedef Eigen::Map<Eigen::Array<T_e, 1, T_dim, Eigen::RowMajor>> eigen_particle;
+
+protected:
+    system<T_e>* problem_;
+    // target container
+    basic_scontainer<T_e, T_dim>* container_;
+    // trial vectors
+    basic_scontainer<T_e, T_dim>* candidates_;
+    de_mutation mutation_;
+    de_adaptation adaptation_;
+    // CR and F for the fixed scheme and initial means for adaptive schemes
+    T_e CR_;
+    T_e DW_;
+    // fraction of the population used for choosing pbest
+    T_e p_best_rate_;
+    // learning rate of JADE
+    T_e learning_rate_;
+    // success history owned by the runtime
+    de_success_history<T_e>* history_;
+
+    // parents of each trial, n x 3
+    std::vector<int> parents_;
+    // pbest or best parent of each trial
+    std::vector<int> guides_;
+    // dimension that is always taken from the mutant
+    std::vector<int> forced_dim_;
+    // CR and F of each trial
+    std::vector<T_e> cr_;
+    std::vector<T_e> f_;
+    // particle indices sorted by value
+    std::vector<int> sorted_;
+    // improvement of each trial over its target, zero for failures
+    std::vector<T_e> improvements_;
+    // uniform random numbers for crossover masks
+    tbb::enumerable_thread_specific<std::vector<T_e>> uniforms_;
+    // next target of single candidates
+    std::atomic<int> next_target_{0};
+
+    T_e rand_uniform(){
+        std::uniform_real_distribution<T_e> dist(0.0, 1.0);
+        return dist(rocky::utils::random::prng());
+    }
+    int rand_index(int n){
+        std::uniform_int_distribution<int> dist(0, n - 1);
+        return dist(rocky::utils::random::prng());
+    }
+    /**
+     * @brief draw CR and F for all trials
+     * 
+     * @return * void 
+     */
+    void generate_parameters(){
+        const int n = container_->n_particles();
+        if(adaptation_ == de_adaptation::fixed){
+            std::fill(cr_.begin(), cr_.end(), CR_);
+            std::fill(f_.begin(), f_.end(), DW_);
+            return;
+        }
+        auto& prng = rocky::utils::random::prng();
+        std::normal_distribution<T_e> normal(0.0, 0.1);
+        std::cauchy_distribution<T_e> cauchy(0.0, 0.1);
+        for(int i=0; i<n; i++){
+            int slot = (adaptation_ == de_adaptation::shade) ? rand_index(history_->cr.size()) : 0;
+            cr_[i] = std::clamp<T_e>(history_->cr[slot] + normal(prng), 0.0, 1.0);
+            T_e f;
+            do{
+                f = history_->f[slot] + cauchy(prng);
+            } while(f <= 0.0);
+            f_[i] = std::min<T_e>(f, 1.0);
+        }
+    }
+    /**
+     * @brief draw distinct parents for all trials
+     * 
+     * @return * void 
+     */
+    void generate_parents(){
+        const int n = container_->n_particles();
+        if(mutation_ != de_mutation::rand_1){
+            std::iota(sorted_.begin(), sorted_.end(), 0);
+            int top = (mutation_ == de_mutation::best_1) ? 1 : std::max(1, static_cast<int>(p_best_rate_ * n));
+            std::partial_sort(sorted_.begin(), sorted_.begin() + top, sorted_.end(), [this](int x, int y){
+                return this->container_->values[x] < this->container_->values[y];
+            });
+            for(int i=0; i<n; i++)
+                guides_[i] = sorted_[rand_index(top)];
+        }
+        for(int i=0; i<n; i++){
+            int* r = &parents_[3 * i];
+            do{ r[0] = rand_index(n); } while(r[0] == i);
+            do{ r[1] = rand_index(n); } while(r[1] == i || r[1] == r[0]);
+            do{ r[2] = rand_index(n); } while(r[2] == i || r[2] == r[0] || r[2] == r[1]);
+            forced_dim_[i] = rand_index(T_dim);
+        }
+    }
+    /**
+     * @brief build the trial vector of a target
+     * 
+     * @param i target index
+     * @param out destination of the trial vector
+     * @return * void 
+     */
+    void build_trial(int i, T_e* out){
+        const int* r = &parents_[3 * i];
+        const T_e F = f_[i];
+        eigen_particle x(container_->particle(i));
+        eigen_particle trial(out);
+        switch(mutation_){
+            case de_mutation::rand_1:
+                trial = eigen_particle(container_->particle(r[0])) + F * (eigen_particle(container_->particle(r[1])) - eigen_particle(container_->particle(r[2])));
+                break;
+            case de_mutation::best_1:
+                trial = eigen_particle(container_->particle(guides_[i])) + F * (eigen_particle(container_->particle(r[0])) - eigen_particle(container_->particle(r[1])));
+                break;
+            case de_mutation::current_to_pbest_1:
+                trial = x + F * (eigen_particle(container_->particle(guides_[i])) - x) + F * (eigen_particle(container_->particle(r[0])) - eigen_particle(container_->particle(r[1])));
+                break;
+        }
+        // binomial crossover
+        T_e forced = trial[forced_dim_[i]];
+        auto& uniforms = uniforms_.local();
+        uniforms.resize(T_dim);
+        std::uniform_real_distribution<T_e> dist(0.0, 1.0);
+        auto& prng = rocky::utils::random::prng();
+        for(auto& u: uniforms)
+            u = dist(prng);
+        eigen_particle mask(uniforms.data());
+        trial = (mask < cr_[i]).select(trial, x);
+        trial[forced_dim_[i]] = forced;
+    }
+    /**
+     * @brief update the success history from the successful trials
+     * 
+     * @return * void 
+     */
+    void adapt(){
+        const auto& improvements = improvements_;
+        T_e weight_sum = 0.0, cr_sum = 0.0, f_sum = 0.0, f_sq_sum = 0.0;
+        int n_successes = 0;
+        for(size_t i=0; i<improvements.size(); i++){
+            if(improvements[i] <= 0.0)
+                continue;
+            // JADE uses arithmetic and Lehmer means, SHADE weights them by the improvement
+            T_e w = (adaptation_ == de_adaptation::shade) ? improvements[i] : 1.0;
+            weight_sum += w;
+            cr_sum += w * cr_[i];
+            f_sum += w * f_[i];
+            f_sq_sum += w * f_[i] * f_[i];
+            n_successes++;
+        }
+        if(n_successes == 0 || f_sum <= 0.0)
+            return;
+        history_->n_successes += n_successes;
+        T_e mean_cr = cr_sum / weight_sum;
+        T_e mean_f = f_sq_sum / f_sum;
+        if(adaptation_ == de_adaptation::jade){
+            history_->cr[0] = (1.0 - learning_rate_) * history_->cr[0] + learning_rate_ * mean_cr;
+            history_->f[0] = (1.0 - learning_rate_) * history_->f[0] + learning_rate_ * mean_f;
+        }
+        else{
+            history_->cr[history_->position] = mean_cr;
+            history_->f[history_->position] = mean_f;
+            history_->position = (history_->position + 1) % history_->cr.size();
+        }
+    }
+
+public:
+    /**
+     * @param history success history, required by adaptive schemes
+     * @param CR crossover probability, the initial mean for adaptive schemes
+     * @param DW differential weight, the initial mean for adaptive schemes
+     * @param p_best_rate fraction of the best solutions used as pbest
+     * @param learning_rate learning rate of the JADE means
+     */
+    adaptive_differential_evolution(system<T_e>* problem, basic_scontainer<T_e, T_dim>* container, basic_scontainer<T_e, T_dim>* candidates,
+                                    de_mutation mutation, de_adaptation adaptation, de_success_history<T_e>* history=nullptr,
+                                    T_e CR=0.5, T_e DW=0.5, T_e p_best_rate=0.1, T_e learning_rate=0.1){
+        this->problem_ = problem;
+        this->container_ = container;
+        this->candidates_ = candidates;
+        this->mutation_ = mutation;
+        this->adaptation_ = adaptation;
+        this->history_ = history;
+        this->CR_ = CR;
+        this->DW_ = DW;
+        this->p_best_rate_ = p_best_rate;
+        this->learning_rate_ = learning_rate;
+        if(adaptation_ != de_adaptation::fixed && history_ == nullptr){
+            spdlog::warn("adaptive differential evolution requires a success history, falling back to fixed parameters");
+            this->adaptation_ = de_adaptation::fixed;
+        }
+        const int n = container->n_particles();
+        parents_.resize(3 * n);
+        guides_.resize(n);
+        forced_dim_.resize(n);
+        cr_.resize(n);
+        f_.resize(n);
+        sorted_.resize(n);
+        improvements_.resize(n);
+    }
+    virtual basic_scontainer<T_e, T_dim>* target(){
+        return container_;
+    }
+    // draw the parents and parameters of a generation of single candidates
+    virtual void prepare(){
+        generate_parameters();
+        generate_parents();
+        next_target_ = 0;
+    }
+    // trials of single candidates compete with the worst solution and do not adapt CR and F
+    virtual void generate(T_e* candidate){
+        int i = next_target_.fetch_add(1) % container_->n_particles();
+        build_trial(i, candidate);
+    }
+    virtual void apply(){
+        const int n = container_->n_particles();
+        if(n < 4){
+            spdlog::warn("For using differential evolution the number of particles must be at least 4!");
+            return;
+        }
+        if(this->run_pipelined(n))
+            return;
+        generate_parameters();
+        generate_parents();
+        tbb::parallel_for(0, n, [this](int i){
+            this->build_trial(i, this->candidates_->particle(i));
+        });
+        // evaluate all trials at once
+        this->evaluate_candidates(problem_, candidates_, 0, n, container_, true);
+        // one-to-one selection
+        tbb::parallel_for(0, n, [this](int i){
+            T_e trial_value = this->candidates_->values[i];
+            T_e target_value = this->container_->values[i];
+            this->improvements_[i] = 0.0;
+            if(trial_value <= target_value){
+                std::copy(this->candidates_->particle(i), this->candidates_->particle(i) + T_dim, this->container_->particle(i));
+                this->container_->values[i] = trial_value;
+                if(trial_value < target_value)
+                    this->improvements_[i] = (target_value == std::numeric_limits<T_e>::max()) ? 1.0 : target_value - trial_value;
+            }
+        });
+        if(adaptation_ != de_adaptation::fixed)
+            adapt();
+    }
+};
+
 };
 };
 
@@ -7,9 +7,12 @@
 
 
 #include <rocky/zagros/strategies/strategy.h>
+#include <rocky/zagros/strategies/pipeline.h>
+#include <rocky/zagros/strategies/surrogate.h>
 
 #include <Eigen/Core>
 #include <Eigen/Cholesky>
+#include <Eigen/Eigenvalues>
 
 
 namespace rocky{
@@ -18,16 +21,12 @@ namespace zagros{
 /**
  * @brief Base class for estimation of distribution algorithms
  * 
+ * Each step estimates a distribution from the top-k solutions of the target container,
+ * samples candidates from it and replaces the worst solutions with the better candidates.
+ * Subclasses provide the distribution.
  */
 template<typename T_e, int T_dim>
-class eda_strategy: public basic_strategy<T_e, T_dim>{};
-
-/**
- * @brief estimating the distribution of solutions using eda
- * 
- */
-template<typename T_e, int T_dim>
-class eda_mutivariate_normal: public eda_strategy<T_e, T_dim>{
+class eda_strategy: public basic_strategy<T_e, T_dim>, public surrogate_assisted<T_e, T_dim>{
 protected:
     // system
     system<T_e>* problem_;
@@ -35,73 +34,417 @@ protected:
     basic_scontainer<T_e, T_dim>* target_container_;
     // container holding the generated candidates
     basic_scontainer<T_e, T_dim>* candidates_container_;
-    // number of generated candidates
-    std::vector<T_e> top_particles_mem_; 
+    // a copy of the top-k solutions
+    std::vector<T_e> top_particles_mem_;
     // a placeholder for top-k solutions
     std::vector<int> solution_ind_;
-    // covariance matrix
-    std::vector<T_e> cov_mem_;
     // mean vector
     std::vector<T_e> mean_mem_;
-    // sample size for computing covariance matrix
+    // candidates before shifting by the mean, n_candidates x dim
+    std::vector<T_e> samples_mem_;
+    // sample size for estimating the distribution
     int sample_size_;
     // number of generated candidates in each step
     int n_candidates_;
 
+    /**
+     * @brief copy the top-k solutions of the target container
+     * 
+     * @return * void 
+     */
+    void select_top_k(){
+        // find top k solutions
+        target_container_->best_k(solution_ind_.data(), sample_size_);
+        // copy the best soluions
+        T_e* top_particles_ptr = top_particles_mem_.data();
+        tbb::parallel_for(0, sample_size_, [&](int p){
+            std::copy(this->target_container_->particle(this->solution_ind_[p]),
+                      this->target_container_->particle(this->solution_ind_[p]) + T_dim,
+                      top_particles_ptr + p * T_dim);
+        });
+    }
+    /**
+     * @brief evaluate the generated candidates and replace the worst solutions
+     * the unused part of the candidates container never replaces a solution
+     * 
+     * @return * void 
+     */
+    void evaluate_and_replace(){
+        this->evaluate_candidates(problem_, candidates_container_, 0, n_candidates_, target_container_);
+        std::fill(candidates_container_->values.begin() + n_candidates_, candidates_container_->values.end(), std::numeric_limits<T_e>::max());
+        target_container_->replace_with(candidates_container_);
+    }
+
 public:
-    eda_mutivariate_normal(system<T_e>* problem, basic_scontainer<T_e, T_dim>* tgt_container, basic_scontainer<T_e, T_dim>* cnd_container, int sample_size){
+    /**
+     * @param sample_size number of top solutions used for estimating the distribution
+     * @param n_candidates number of candidates generated in each step, non-positive values use the whole candidates container
+     */
+    eda_strategy(system<T_e>* problem, basic_scontainer<T_e, T_dim>* tgt_container, basic_scontainer<T_e, T_dim>* cnd_container, int sample_size, int n_candidates=0){
         this->problem_ = problem;
         this->target_container_ = tgt_container;
         this->candidates_container_ = cnd_container;
         this->sample_size_ = sample_size;
         this->n_candidates_ = cnd_container->n_particles();
-        top_particles_mem_.resize(sample_size * T_dim);
-        solution_ind_.resize(sample_size);
-        cov_mem_.resize(T_dim * T_dim);
+        if(n_candidates > 0)
+            this->n_candidates_ = std::min(n_candidates, cnd_container->n_particles());
+        top_particles_mem_.resize(sample_size_ * T_dim);
+        solution_ind_.resize(sample_size_);
         mean_mem_.resize(T_dim);
+        samples_mem_.resize(n_candidates_ * T_dim);
     }
-    void sample_std_normal(T_e* vec){
-        static std::normal_distribution<T_e> dist(0.0, 1.0);
-        tbb::parallel_for(0, T_dim, [&](auto i){
-            vec[i] = dist(rocky::utils::random::prng());
-        });
-    }
+    // estimate the distribution of the top-k solutions
+    virtual void estimate_distribution() = 0;
+    // prepare the estimated distribution for sampling
+    virtual void decompose() = 0;
+    // fill the candidates container with samples of the distribution
+    virtual void sample_candidates() = 0;
     virtual void apply(){
-        // find top k solutions
-        target_container_->best_k(solution_ind_.data(), sample_size_);
-        // copy the best soluions
-        T_e* top_particles_ptr = top_particles_mem_.data();
+        estimate_distribution();
+        decompose();
+        sample_candidates();
+        evaluate_and_replace();
+    }
+};
 
-        tbb::parallel_for(0, sample_size_, [&](int p){
-            std::copy(this->target_container_->particle(this->solution_ind_[p]),
-                      this->target_container_->particle(this->solution_ind_[p]) + T_dim,
-                      top_particles_ptr + p * T_dim);
-        });
+/**
+ * @brief estimating the distribution of solutions using eda
+ * 
+ */
+template<typename T_e, int T_dim>
+class eda_mutivariate_normal: public eda_strategy<T_e, T_dim>, public candidate_operator<T_e, T_dim>{
+public:
+    typedef Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> eigen_matrix;
+    typedef Eigen::Map<Eigen::Matrix<T_e, 1, T_dim, Eigen::RowMajor>> eigen_particle;
+
+protected:
+    // covariance matrix
+    std::vector<T_e> cov_mem_;
+    // standard normal variates of all candidates, n_candidates x dim
+    std::vector<T_e> z_mem_;
+    // cholesky decomposition of the covariance matrix
+    Eigen::LLT<Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> llt_;
+    // the covariance is factor_scale_ * L * L^T where L is the cholesky factor in llt_
+    T_e factor_scale_;
+
+public:
+    /**
+     * @param sample_size number of top solutions used for estimating the distribution
+     * @param n_candidates number of candidates generated in each step, non-positive values use the whole candidates container
+     */
+    eda_mutivariate_normal(system<T_e>* problem, basic_scontainer<T_e, T_dim>* tgt_container, basic_scontainer<T_e, T_dim>* cnd_container, int sample_size, int n_candidates=0)
+    :eda_strategy<T_e, T_dim>(problem, tgt_container, cnd_container, sample_size, n_candidates){
+        z_mem_.resize(this->n_candidates_ * T_dim);
+        cov_mem_.resize(T_dim * T_dim);
+        llt_ = Eigen::LLT<Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(T_dim);
+        factor_scale_ = 1.0;
+    }
+    /**
+     * @brief estimate the mean and covariance of the top-k solutions
+     * 
+     * @return * void 
+     */
+    virtual void estimate_distribution(){
+        this->select_top_k();
         // estimate the mean and covariance
-        Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> top_particles_mat(top_particles_mem_.data(), sample_size_, T_dim);
+        Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> top_particles_mat(this->top_particles_mem_.data(), this->sample_size_, T_dim);
         Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> cov_mat(cov_mem_.data(), T_dim, T_dim);
-        Eigen::Map<Eigen::Matrix<T_e, 1, T_dim, Eigen::RowMajor>> mean_mat(mean_mem_.data());
+        Eigen::Map<Eigen::Matrix<T_e, 1, T_dim, Eigen::RowMajor>> mean_mat(this->mean_mem_.data());
 
         mean_mat = top_particles_mat.colwise().mean();
         top_particles_mat.rowwise() -= mean_mat;
-        cov_mat = (top_particles_mat.adjoint() * top_particles_mat) / static_cast<T_e>(sample_size_-1);
-        // cholesky decomposition
-        Eigen::LLT<Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> llt(cov_mat);
-        // generate samples from mvn
-        tbb::parallel_for(0, sample_size_, [&](auto p){
-            Eigen::Map<Eigen::Matrix<T_e, 1, T_dim, Eigen::RowMajor>> sample_mat(this->candidates_container_->particle(p));
-            sample_std_normal(this->candidates_container_->particle(p));
-            sample_mat = (llt.matrixL() * sample_mat.transpose()).transpose();
-            sample_mat.rowwise() += mean_mat;
-        }); 
-        // evaluate generated candidates
-        this->candidates_container_->evaluate_and_update(this->problem_);
-        // replace the best candidates in the target container
-        this->target_container_->replace_with(this->candidates_container_);
-   }
+        cov_mat = (top_particles_mat.adjoint() * top_particles_mat) / static_cast<T_e>(this->sample_size_-1);
+    }
+    /**
+     * @brief cholesky decomposition of the estimated covariance matrix
+     * 
+     * @return * void 
+     */
+    virtual void decompose(){
+        Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> cov_mat(cov_mem_.data(), T_dim, T_dim);
+        llt_.compute(cov_mat);
+    }
+    /**
+     * @brief generate candidates from the estimated distribution
+     * 
+     * @return * void 
+     */
+    virtual void sample_candidates(){
+        eigen_particle mean_mat(this->mean_mem_.data());
+        eigen_matrix z_mat(z_mem_.data(), this->n_candidates_, T_dim);
+        eigen_matrix samples_mat(this->samples_mem_.data(), this->n_candidates_, T_dim);
+        // standard normal variates, each task fills a block of rows
+        tbb::parallel_for(tbb::blocked_range<int>(0, this->n_candidates_), [&](const tbb::blocked_range<int>& r){
+            rocky::utils::random::normal<T_e>(this->z_mem_.data() + r.begin() * T_dim, (r.end() - r.begin()) * T_dim);
+        });
+        // x^T = z^T L^T for all candidates with a single triangular product
+        samples_mat.noalias() = z_mat * llt_.matrixU();
+        // shift by the mean and copy into the candidates container
+        T_e scale = std::sqrt(this->factor_scale_);
+        tbb::parallel_for(0, this->n_candidates_, [&](int p){
+            eigen_particle candidate_mat(this->candidates_container_->particle(p));
+            candidate_mat = scale * samples_mat.row(p) + mean_mat;
+        });
+    }
+    virtual basic_scontainer<T_e, T_dim>* target(){
+        return this->target_container_;
+    }
+    virtual void prepare(){
+        estimate_distribution();
+        decompose();
+    }
+    // a single candidate, the batched sample_candidates is used in generational mode
+    virtual void generate(T_e* candidate){
+        eigen_particle candidate_mat(candidate);
+        eigen_particle mean_mat(this->mean_mem_.data());
+        rocky::utils::random::normal<T_e>(candidate, T_dim);
+        candidate_mat = std::sqrt(this->factor_scale_) * (llt_.matrixL() * candidate_mat.transpose()).transpose();
+        candidate_mat += mean_mat;
+    }
+    virtual void apply(){
+        if(this->run_pipelined(this->n_candidates_))
+            return;
+        eda_strategy<T_e, T_dim>::apply();
+    }
 }; 
 
+/**
+ * @brief multivariate normal EDA with exponentially smoothed mean and covariance
+ * 
+ * Instead of estimating the covariance from scratch, each step blends the previous
+ * covariance with a rank-mu update built from the top-k solutions:
+ *  C <- (1 - lr) * C + (lr / k) * sum_i (x_i - m)(x_i - m)^T
+ * The cholesky factor is updated with k rank-one updates (O(k d^2)) and the
+ * O(d^3) refactorization is only performed every `refactor_period` steps.
+ */
+template<typename T_e, int T_dim>
+class eda_incremental_mvn: public eda_mutivariate_normal<T_e, T_dim>{
+protected:
+    // learning rate of the mean and covariance
+    T_e learning_rate_;
+    // number of steps between two full factorizations
+    int refactor_period_;
+    // number of steps since the last full factorization
+    int steps_;
+    // whether the distribution has been estimated at least once
+    bool initialized_;
+    // ridge of the last full factorization, the factor then tracks the covariance plus factor_scale_ * ridge_ * I
+    T_e ridge_;
+
+    /**
+     * @brief recompute the cholesky factor from the smoothed covariance
+     * a small ridge is added to the factorized copy if the covariance is not positive definite
+     */
+    void refactorize(){
+        typename eda_mutivariate_normal<T_e, T_dim>::eigen_matrix cov_mat(this->cov_mem_.data(), T_dim, T_dim);
+        this->llt_.compute(cov_mat);
+        this->ridge_ = 0.0;
+        if(this->llt_.info() != Eigen::Success){
+            // the ridge only enters the factor, the running covariance is left unchanged
+            this->ridge_ = std::max(static_cast<T_e>(1e-6) * cov_mat.trace() / T_dim, std::numeric_limits<T_e>::epsilon());
+            Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> ridged = cov_mat;
+            ridged.diagonal().array() += this->ridge_;
+            this->llt_.compute(ridged);
+        }
+        this->factor_scale_ = 1.0;
+        this->steps_ = 0;
+    }
+
+public:
+    eda_incremental_mvn(system<T_e>* problem, basic_scontainer<T_e, T_dim>* tgt_container, basic_scontainer<T_e, T_dim>* cnd_container, int sample_size, T_e learning_rate=0.2, int refactor_period=50, int n_candidates=0)
+    :eda_mutivariate_normal<T_e, T_dim>(problem, tgt_container, cnd_container, sample_size, n_candidates){
+        this->learning_rate_ = learning_rate;
+        this->refactor_period_ = std::max(refactor_period, 1);
+        this->steps_ = 0;
+        this->initialized_ = false;
+        this->ridge_ = 0.0;
+    }
+    // the distribution of a previous block is meaningless for the new one
+    virtual void reset(){
+        this->initialized_ = false;
+    }
+    virtual void estimate_distribution(){
+        if(!initialized_){
+            eda_mutivariate_normal<T_e, T_dim>::estimate_distribution();
+            return;
+        }
+        this->select_top_k();
+        typename eda_mutivariate_normal<T_e, T_dim>::eigen_matrix top_particles_mat(this->top_particles_mem_.data(), this->sample_size_, T_dim);
+        typename eda_mutivariate_normal<T_e, T_dim>::eigen_matrix cov_mat(this->cov_mem_.data(), T_dim, T_dim);
+        typename eda_mutivariate_normal<T_e, T_dim>::eigen_particle mean_mat(this->mean_mem_.data());
+        // the new mean is computed before centering around the previous one
+        Eigen::Matrix<T_e, 1, T_dim, Eigen::RowMajor> top_mean = top_particles_mat.colwise().mean();
+        top_particles_mat.rowwise() -= mean_mat;
+        // rank-mu update of the covariance
+        cov_mat *= (1.0 - learning_rate_);
+        cov_mat.noalias() += (learning_rate_ / this->sample_size_) * (top_particles_mat.adjoint() * top_particles_mat);
+        mean_mat = (1.0 - learning_rate_) * mean_mat + learning_rate_ * top_mean;
+    }
+    virtual void decompose(){
+        if(!initialized_ || steps_ + 1 >= refactor_period_){
+            refactorize();
+            initialized_ = true;
+            return;
+        }
+        steps_++;
+        // (1 - lr) * s * L * L^T + sum_i w * y_i * y_i^T = s' * (L * L^T + sum_i (w / s') * y_i * y_i^T)
+        this->factor_scale_ *= (1.0 - learning_rate_);
+        T_e weight = learning_rate_ / (this->sample_size_ * this->factor_scale_);
+        typename eda_mutivariate_normal<T_e, T_dim>::eigen_matrix top_particles_mat(this->top_particles_mem_.data(), this->sample_size_, T_dim);
+        for(int p=0; p<this->sample_size_; p++){
+            this->llt_.rankUpdate(top_particles_mat.row(p).transpose(), weight);
+            if(this->llt_.info() != Eigen::Success){
+                refactorize();
+                return;
+            }
+        }
+    }
+};
+
+/**
+ * @brief estimation of distribution with a diagonal multivariate normal
+ * 
+ * Each dimension has its own mean and variance, so memory and time per step
+ * are linear in the dimension. Suitable for problems where the full covariance
+ * matrix does not fit in memory.
+ */
+template<typename T_e, int T_dim>
+class eda_diagonal_normal: public eda_strategy<T_e, T_dim>{
+public:
+    typedef Eigen::Map<Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> eigen_matrix;
+    typedef Eigen::Map<Eigen::Matrix<T_e, 1, T_dim, Eigen::RowMajor>> eigen_particle;
+
+protected:
+    // variance of each dimension
+    std::vector<T_e> var_mem_;
+    // standard deviation of each dimension
+    std::vector<T_e> std_mem_;
+
+    /**
+     * @brief fill samples_mem_ with the deviations of the candidates from the mean
+     * 
+     * @return * void 
+     */
+    virtual void sample_deviations(){
+        eigen_matrix samples_mat(this->samples_mem_.data(), this->n_candidates_, T_dim);
+        eigen_particle std_mat(std_mem_.data());
+        tbb::parallel_for(tbb::blocked_range<int>(0, this->n_candidates_), [&](const tbb::blocked_range<int>& r){
+            rocky::utils::random::normal<T_e>(this->samples_mem_.data() + r.begin() * T_dim, (r.end() - r.begin()) * T_dim);
+            samples_mat.middleRows(r.begin(), r.end() - r.begin()).array().rowwise() *= std_mat.array();
+        });
+    }
+
+public:
+    /**
+     * @param sample_size number of top solutions used for estimating the distribution
+     * @param n_candidates number of candidates generated in each step, non-positive values use the whole candidates container
+     */
+    eda_diagonal_normal(system<T_e>* problem, basic_scontainer<T_e, T_dim>* tgt_container, basic_scontainer<T_e, T_dim>* cnd_container, int sample_size, int n_candidates=0)
+    :eda_strategy<T_e, T_dim>(problem, tgt_container, cnd_container, std::max(sample_size, 2), n_candidates){
+        var_mem_.resize(T_dim);
+        std_mem_.resize(T_dim);
+    }
+    /**
+     * @brief estimate the mean and variance of the top-k solutions
+     * the top-k solutions are left centered around the mean
+     * 
+     * @return * void 
+     */
+    virtual void estimate_distribution(){
+        this->select_top_k();
+        eigen_matrix top_particles_mat(this->top_particles_mem_.data(), this->sample_size_, T_dim);
+        eigen_particle mean_mat(this->mean_mem_.data());
+        eigen_particle var_mat(var_mem_.data());
+        mean_mat = top_particles_mat.colwise().mean();
+        top_particles_mat.rowwise() -= mean_mat;
+        var_mat = top_particles_mat.colwise().squaredNorm() / static_cast<T_e>(this->sample_size_ - 1);
+    }
+    /**
+     * @brief standard deviations of the estimated distribution
+     * 
+     * @return * void 
+     */
+    virtual void decompose(){
+        eigen_particle var_mat(var_mem_.data());
+        eigen_particle std_mat(std_mem_.data());
+        std_mat = var_mat.array().sqrt();
+    }
+    /**
+     * @brief generate candidates from the estimated distribution
+     * 
+     * @return * void 
+     */
+    virtual void sample_candidates(){
+        sample_deviations();
+        eigen_matrix samples_mat(this->samples_mem_.data(), this->n_candidates_, T_dim);
+        eigen_particle mean_mat(this->mean_mem_.data());
+        tbb::parallel_for(0, this->n_candidates_, [&](int p){
+            eigen_particle candidate_mat(this->candidates_container_->particle(p));
+            candidate_mat = samples_mat.row(p) + mean_mat;
+        });
+    }
+};
+
+/**
+ * @brief estimation of distribution with a low-rank plus diagonal covariance
+ * 
+ * The covariance is approximated by W * W^T + D where the k columns of W are the
+ * leading principal directions of the top solutions and D keeps the remaining
+ * variance of each dimension. The principal directions are computed from the
+ * sample_size x sample_size gram matrix, so each step costs O(d * (sample_size^2 + n_candidates * k)).
+ */
+template<typename T_e, int T_dim>
+class eda_low_rank_normal: public eda_diagonal_normal<T_e, T_dim>{
+protected:
+    typedef typename eda_diagonal_normal<T_e, T_dim>::eigen_matrix eigen_matrix;
+    typedef typename eda_diagonal_normal<T_e, T_dim>::eigen_particle eigen_particle;
+    typedef Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic> dense_matrix;
 
+    // rank of the factor
+    int rank_;
+    // low-rank factor, dim x rank
+    std::vector<T_e> factor_mem_;
+    // standard normal variates for the low-rank part, n_candidates x rank
+    std::vector<T_e> z_mem_;
+    // eigen decomposition of the gram matrix of the top-k solutions
+    Eigen::SelfAdjointEigenSolver<dense_matrix> gram_solver_;
+
+    virtual void sample_deviations(){
+        eda_diagonal_normal<T_e, T_dim>::sample_deviations();
+        eigen_matrix samples_mat(this->samples_mem_.data(), this->n_candidates_, T_dim);
+        eigen_matrix z_mat(z_mem_.data(), this->n_candidates_, rank_);
+        eigen_matrix factor_mat(factor_mem_.data(), T_dim, rank_);
+        rocky::utils::random::normal<T_e>(z_mem_.data(), z_mem_.size());
+        samples_mat.noalias() += z_mat * factor_mat.transpose();
+    }
+
+public:
+    /**
+     * @param rank number of principal directions, at most sample_size - 1
+     */
+    eda_low_rank_normal(system<T_e>* problem, basic_scontainer<T_e, T_dim>* tgt_container, basic_scontainer<T_e, T_dim>* cnd_container, int sample_size, int rank, int n_candidates=0)
+    :eda_diagonal_normal<T_e, T_dim>(problem, tgt_container, cnd_container, sample_size, n_candidates){
+        this->rank_ = std::clamp(rank, 1, this->sample_size_ - 1);
+        factor_mem_.resize(T_dim * rank_);
+        z_mem_.resize(this->n_candidates_ * rank_);
+    }
+    virtual void estimate_distribution(){
+        eda_diagonal_normal<T_e, T_dim>::estimate_distribution();
+        const int k = this->sample_size_;
+        eigen_matrix top_particles_mat(this->top_particles_mem_.data(), k, T_dim);
+        eigen_matrix factor_mat(factor_mem_.data(), T_dim, rank_);
+        eigen_particle var_mat(this->var_mem_.data());
+        // the non-zero eigenvalues of Y^T Y / (k-1) are shared with the gram matrix Y Y^T / (k-1)
+        dense_matrix gram = (top_particles_mat * top_particles_mat.transpose()) / static_cast<T_e>(k - 1);
+        gram_solver_.compute(gram);
+        // eigenvalues are in increasing order, W = Y^T v / sqrt(k-1) has the squared norm of the eigenvalue
+        auto leading = gram_solver_.eigenvectors().rightCols(rank_);
+        factor_mat.noalias() = (top_particles_mat.transpose() * leading) / std::sqrt(static_cast<T_e>(k - 1));
+        // the diagonal keeps the variance that is not explained by the factor
+        T_e floor = std::numeric_limits<T_e>::epsilon() * std::max(var_mat.maxCoeff(), static_cast<T_e>(1.0));
+        var_mat = (var_mat.array() - factor_mat.rowwise().squaredNorm().transpose().array()).max(floor);
+    }
+};
 
 }; // end of zagros
 }; // end of rocky
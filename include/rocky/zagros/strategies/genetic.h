@@ -5,6 +5,8 @@
 #ifndef ROCKY_ZAGROS_GENETIC_STRATEGY
 #define ROCKY_ZAGROS_GENETIC_STRATEGY
 #include <rocky/zagros/strategies/strategy.h>
+#include <rocky/zagros/strategies/pipeline.h>
+#include <rocky/zagros/strategies/surrogate.h>
 #include <set>
 #include <iterator>
 
@@ -23,7 +25,7 @@ class mutation_strategy: public basic_strategy<T_e, T_dim>{};
  * 
  */
 template<typename T_e, int T_dim>
-class dimension_tweak_strategy: public mutation_strategy<T_e, T_dim>{
+class dimension_tweak_strategy: public mutation_strategy<T_e, T_dim>, public candidate_operator<T_e, T_dim>, public surrogate_assisted<T_e, T_dim>{
 protected:
     // system
     system<T_e>* problem_;
@@ -43,22 +45,30 @@ public:
         this->k_ = k;
         this->n_mutations_ = cnd_container->n_particles();
     }
-    virtual void tweak(int p_ind, int dim) = 0;
+    virtual void tweak(T_e* candidate, int dim) = 0;
+    virtual basic_scontainer<T_e, T_dim>* target(){
+        return target_container_;
+    }
+    virtual void generate(T_e* candidate){
+        int samples[1];
+        this->target_container_->sample_n_particles(samples, 1);
+        std::copy(this->target_container_->particle(samples[0]),
+                  this->target_container_->particle(samples[0])+T_dim,
+                  candidate);
+         // apply mutation on k dimensions
+        for(int d=0; d<k_; d++){
+            // choose a random dim
+            int dim = this->target_container_->sample_dim();
+            this->tweak(candidate, dim);
+        }
+    }
     virtual void apply(){
+        if(this->run_pipelined(n_mutations_))
+            return;
         tbb::parallel_for(0, n_mutations_, [this](int p){
-            int samples[1];
-            this->target_container_->sample_n_particles(samples, 1);
-            std::copy(this->target_container_->particle(samples[0]),
-                      this->target_container_->particle(samples[0])+T_dim,
-                      this->candidates_->particle(p));
-             // apply mutation on k dimensions
-            for(int d=0; d<k_; d++){
-                // choose a random dim
-                int dim = this->target_container_->sample_dim();
-                this->tweak(p, dim);
-            }
+            this->generate(this->candidates_->particle(p));
         });
-        candidates_->evaluate_and_update(problem_);
+        this->evaluate_candidates(problem_, candidates_, 0, n_mutations_, target_container_);
         target_container_->replace_with(candidates_);
     }
 }; 
@@ -85,8 +95,8 @@ public:
         auto z = dist(rocky::utils::random::prng());
         return z;
     }
-    virtual void tweak(int p_ind, int dim){
-        this->candidates_->particles[p_ind][dim] += gaussian_noise();
+    virtual void tweak(T_e* candidate, int dim){
+        candidate[dim] += gaussian_noise();
     }
 };
 
@@ -146,7 +156,7 @@ public:
 
 
 template<typename T_e, int T_dim>
-class static_segment_crossover: public crossover_strategy<T_e, T_dim>{
+class static_segment_crossover: public crossover_strategy<T_e, T_dim>, public candidate_operator<T_e, T_dim>, public surrogate_assisted<T_e, T_dim>{
 protected:
     // system
     system<T_e>* problem_;
@@ -166,7 +176,25 @@ public:
         this->container_ = container;
         this->candidates_ = cnd_container;
     }
+    virtual basic_scontainer<T_e, T_dim>* target(){
+        return container_;
+    }
+    // a single child made of a parent and a segment of another parent
+    virtual void generate(T_e* candidate){
+        int parents[2];
+        this->container_->sample_n_particles(parents, 2);
+        std::uniform_int_distribution<> point_dist(0, T_dim - segment_length_ - 1);
+        int point = point_dist(rocky::utils::random::prng());
+        std::copy(this->container_->particle(parents[0]),
+                  this->container_->particle(parents[0])+T_dim,
+                  candidate);
+        std::copy(this->container_->particle(parents[1])+point,
+                  this->container_->particle(parents[1])+point+segment_length_,
+                  candidate+point);
+    }
     virtual void apply(){
+        if(this->run_pipelined(2 * n_crossovers_))
+            return;
         tbb::parallel_for(0, n_crossovers_, [this](auto ci){
             // select two distinct parents
             int parents[2];
@@ -187,7 +215,7 @@ public:
             }
         });
         // evaluate the candidates
-        this->candidates_->evaluate_and_update(problem_);
+        this->evaluate_candidates(problem_, this->candidates_, 0, 2 * n_crossovers_, this->container_);
         this->container_->replace_with(this->candidates_);
     }
 };
@@ -38,7 +38,7 @@ public:
     virtual void apply(){
         tbb::parallel_for(0, this->container_->n_particles(), [&](auto p){
             for(int d=0; d<T_dim; ++d)
-               this->container_->particle(p)[d] = rand_uniform(this->problem_->lower_bound(p), this->problem_->upper_bound(p));
+               this->container_->particle(p)[d] = rand_uniform(this->problem_->lower_bound(d), this->problem_->upper_bound(d));
         });
     };
 };
@@ -0,0 +1,280 @@
+/*
+    Copyright (C) 2022 Amirabbas Asadi , All Rights Reserved
+    distributed under Apache-2.0 license
+*/
+#ifndef ROCKY_ZAGROS_PIPELINE_STRATEGY
+#define ROCKY_ZAGROS_PIPELINE_STRATEGY
+
+#include <rocky/zagros/strategies/strategy.h>
+
+#include <tbb/concurrent_queue.h>
+#include <tbb/spin_rw_mutex.h>
+#include <tbb/task_group.h>
+#include <tbb/task_arena.h>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
+
+namespace rocky{
+namespace zagros{
+
+template<typename T_e, int T_dim>
+class pipelined_evaluator;
+
+/**
+ * @brief Interface for strategies that can produce candidates one at a time
+ *
+ * Such strategies can stream their candidates through a pipeline instead of
+ * generating, evaluating and merging the whole population in separate phases.
+ */
+template<typename T_e, int T_dim>
+class candidate_operator{
+protected:
+    // evaluator used in pipelined mode, null in generational mode
+    std::unique_ptr<pipelined_evaluator<T_e, T_dim>> pipeline_;
+    /**
+     * @brief stream n candidates through the pipeline if pipelined mode is enabled
+     *
+     * @param n number of candidates
+     * @return true if the candidates were processed by the pipeline
+     */
+    bool run_pipelined(int n){
+        if(!pipeline_)
+            return false;
+        prepare();
+        pipeline_->run(this, n);
+        return true;
+    }
+
+public:
+    virtual ~candidate_operator() {}
+    /**
+     * @brief the container that receives accepted candidates
+     *
+     * @return * basic_scontainer<T_e, T_dim>*
+     */
+    virtual basic_scontainer<T_e, T_dim>* target() = 0;
+    /**
+     * @brief work that needs the whole population before generating candidates
+     * e.g. estimating a distribution
+     *
+     * @return * void
+     */
+    virtual void prepare() {}
+    /**
+     * @brief write a new candidate
+     * may be called concurrently while no candidate is being merged into the target
+     *
+     * @param candidate destination of the candidate
+     * @return * void
+     */
+    virtual void generate(T_e* candidate) = 0;
+    /**
+     * @brief evaluate candidates as a stream
+     *
+     * @param problem objective system
+     * @param n_tokens maximum number of candidates in flight
+     * @return * void
+     */
+    void enable_pipeline(system<T_e>* problem, int n_tokens){
+        pipeline_ = std::make_unique<pipelined_evaluator<T_e, T_dim>>(problem, n_tokens);
+    }
+};
+
+/**
+ * @brief replace the worst solution of a container if the candidate is better
+ *
+ * @param target target container
+ * @param candidate evaluated candidate
+ * @param value objective value of the candidate
+ * @return true if the candidate was accepted
+ */
+template<typename T_e, int T_dim>
+bool replace_worst(basic_scontainer<T_e, T_dim>* target, const T_e* candidate, T_e value){
+    auto worst = std::max_element(target->values.begin(), target->values.end());
+    if(!(value < *worst))
+        return false;
+    int worst_ind = static_cast<int>(worst - target->values.begin());
+    std::copy(candidate, candidate + T_dim, target->particle(worst_ind));
+    *worst = value;
+    return true;
+}
+
+/**
+ * @brief stream candidates through generation, evaluation and merging
+ *
+ * Candidates are generated and evaluated in parallel and merged one at a time
+ * by replacing the worst solution of the target container, so there is no
+ * barrier between generating and evaluating a population.
+ */
+template<typename T_e, int T_dim>
+class pipelined_evaluator{
+protected:
+    // system
+    system<T_e>* problem_;
+    // maximum number of candidates in flight
+    int n_tokens_;
+    // candidates in flight, n_tokens x dim
+    std::vector<T_e> slots_;
+    // objective values of the candidates in flight
+    std::vector<T_e> slot_values_;
+    // acceptance thresholds of the candidates in flight
+    std::vector<T_e> slot_thresholds_;
+    // slots that can be reused
+    tbb::concurrent_queue<int> free_slots_;
+    // generating reads the target container and merging writes to it
+    tbb::spin_rw_mutex target_mutex_;
+
+public:
+    pipelined_evaluator(system<T_e>* problem, int n_tokens){
+        this->problem_ = problem;
+        this->n_tokens_ = std::max(n_tokens, 1);
+        slots_.resize(n_tokens_ * T_dim);
+        slot_values_.resize(n_tokens_);
+        slot_thresholds_.resize(n_tokens_);
+    }
+    int n_tokens() const{
+        return n_tokens_;
+    }
+    /**
+     * @brief generate, evaluate and merge candidates
+     *
+     * @param op candidate operator
+     * @param n_candidates number of candidates
+     * @return * int number of accepted candidates
+     */
+    int run(candidate_operator<T_e, T_dim>* op, int n_candidates){
+        free_slots_.clear();
+        for(int s=0; s<n_tokens_; s++)
+            free_slots_.push(s);
+        auto target = op->target();
+        int produced = 0;
+        int accepted = 0;
+        tbb::parallel_pipeline(n_tokens_,
+            tbb::make_filter<void, int>(tbb::filter_mode::serial_in_order, [&](tbb::flow_control& fc) -> int{
+                if(produced == n_candidates){
+                    fc.stop();
+                    return -1;
+                }
+                produced++;
+                int slot = -1;
+                // there are as many slots as tokens
+                free_slots_.try_pop(slot);
+                return slot;
+            }) &
+            tbb::make_filter<int, int>(tbb::filter_mode::parallel, [&](int slot) -> int{
+                T_e* candidate = this->slots_.data() + slot * T_dim;
+                {
+                    tbb::spin_rw_mutex::scoped_lock lock(this->target_mutex_, false);
+                    op->generate(candidate);
+                    // the worst value never increases so it stays a valid threshold until merging
+                    this->slot_thresholds_[slot] = *std::max_element(target->values.begin(), target->values.end());
+                }
+                this->slot_values_[slot] = this->problem_->objective_bounded(candidate, this->slot_thresholds_[slot]);
+                return slot;
+            }) &
+            tbb::make_filter<int, void>(tbb::filter_mode::serial_out_of_order, [&](int slot){
+                {
+                    tbb::spin_rw_mutex::scoped_lock lock(this->target_mutex_, true);
+                    if(replace_worst(target, this->slots_.data() + slot * T_dim, this->slot_values_[slot]))
+                        accepted++;
+                }
+                this->free_slots_.push(slot);
+            })
+        );
+        return accepted;
+    }
+};
+
+/**
+ * @brief asynchronous steady-state evaluation
+ *
+ * A pool of workers evaluates candidates continuously. Each completed evaluation
+ * is merged into the target container of its operator right away and the worker
+ * generates its next candidate from the updated population, so slow evaluations
+ * never hold back the other workers. Operators are visited in a round-robin order
+ * and are prepared again after every n_particles completions of their own.
+ */
+template<typename T_e, int T_dim>
+class steady_state_evaluator{
+protected:
+    // system
+    system<T_e>* problem_;
+    // operators producing the candidates
+    std::vector<candidate_operator<T_e, T_dim>*> operators_;
+    // number of concurrent evaluations
+    int n_workers_;
+    // generating reads the target containers and merging writes to them
+    // blocking, a worker may hold it during a whole preparation
+    std::shared_mutex target_mutex_;
+
+public:
+    steady_state_evaluator(system<T_e>* problem, int n_workers=0){
+        this->problem_ = problem;
+        if(n_workers <= 0)
+            n_workers = tbb::this_task_arena::max_concurrency();
+        this->n_workers_ = n_workers;
+    }
+    void add_operator(candidate_operator<T_e, T_dim>* op){
+        operators_.push_back(op);
+    }
+    int n_operators() const{
+        return operators_.size();
+    }
+    int n_workers() const{
+        return n_workers_;
+    }
+    /**
+     * @brief evaluate a fixed number of candidates
+     *
+     * @param n_evaluations evaluation budget
+     * @return * int number of accepted candidates
+     */
+    int run(int n_evaluations){
+        if(operators_.empty())
+            return 0;
+        const int n_ops = operators_.size();
+        // completions of each operator since its last preparation
+        std::vector<int> completions(n_ops, 0);
+        for(auto op: operators_)
+            op->prepare();
+        std::atomic<int> issued{0};
+        int accepted = 0;
+        tbb::task_group workers;
+        for(int w=0; w<n_workers_; w++){
+            workers.run([&](){
+                std::vector<T_e> candidate(T_dim);
+                int e;
+                while((e = issued.fetch_add(1)) < n_evaluations){
+                    const int oi = e % n_ops;
+                    auto op = this->operators_[oi];
+                    T_e threshold;
+                    {
+                        std::shared_lock<std::shared_mutex> lock(this->target_mutex_);
+                        op->generate(candidate.data());
+                        threshold = *std::max_element(op->target()->values.begin(), op->target()->values.end());
+                    }
+                    T_e value = this->problem_->objective_bounded(candidate.data(), threshold);
+                    std::unique_lock<std::shared_mutex> lock(this->target_mutex_);
+                    if(replace_worst(op->target(), candidate.data(), value))
+                        accepted++;
+                    if(++completions[oi] >= op->target()->n_particles()){
+                        completions[oi] = 0;
+                        // preparing may run parallel algorithms, isolating them keeps this thread
+                        // from picking up another worker that would wait for the lock it holds
+                        tbb::this_task_arena::isolate([op](){
+                            op->prepare();
+                        });
+                    }
+                }
+            });
+        }
+        workers.wait();
+        return accepted;
+    }
+};
+
+}; // end of zagros
+}; // end of rocky
+#endif
@@ -0,0 +1,271 @@
+/*
+    Copyright (C) 2022 Amirabbas Asadi , All Rights Reserved
+    distributed under Apache-2.0 license
+*/
+#ifndef ROCKY_ZAGROS_SURROGATE_STRATEGY
+#define ROCKY_ZAGROS_SURROGATE_STRATEGY
+
+#include <rocky/zagros/strategies/strategy.h>
+
+
+namespace rocky{
+namespace zagros{
+
+/**
+ * @brief the values a range of candidates must not exceed to enter a container
+ *
+ * @param destination the container that receives the candidates
+ * @param start first candidate
+ * @param n number of candidates
+ * @param one_to_one candidate i competes with solution i instead of the worst solution
+ * @param thresholds destination of the thresholds
+ */
+template<typename T_e, int T_dim>
+void acceptance_thresholds(basic_scontainer<T_e, T_dim>* destination, int start, int n, bool one_to_one, std::vector<T_e>& thresholds){
+    thresholds.resize(n);
+    if(one_to_one){
+        std::copy(destination->values.begin() + start, destination->values.begin() + start + n, thresholds.begin());
+        return;
+    }
+    T_e worst = *std::max_element(destination->values.begin(), destination->values.end());
+    std::fill(thresholds.begin(), thresholds.end(), worst);
+}
+
+/**
+ * @brief k-nearest neighbors regression on recently evaluated solutions
+ *
+ * The archive is a ring buffer so the model follows the moving population.
+ * Predictions are inverse-distance weighted means of the k nearest solutions
+ * and the distances of a batch are computed with a single matrix product.
+ */
+template<typename T_e, int T_dim>
+class knn_surrogate{
+public:
+    typedef Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> matrix_type;
+    typedef Eigen::Matrix<T_e, Eigen::Dynamic, 1> vector_type;
+
+protected:
+    // number of neighbors
+    int k_;
+    // maximum number of archived solutions
+    int capacity_;
+    // number of archived solutions
+    int size_;
+    // next archive row to be overwritten
+    int position_;
+    // archived solutions, capacity x dim
+    matrix_type archive_;
+    // squared norms of the archived solutions
+    vector_type norms_;
+    // objective values of the archived solutions
+    vector_type values_;
+
+public:
+    knn_surrogate(int k=8, int capacity=1024){
+        this->k_ = std::max(k, 1);
+        this->capacity_ = std::max(capacity, k_);
+        archive_.resize(capacity_, T_dim);
+        norms_.resize(capacity_);
+        values_.resize(capacity_);
+        reset();
+    }
+    void reset(){
+        size_ = 0;
+        position_ = 0;
+    }
+    int size() const{
+        return size_;
+    }
+    int k() const{
+        return k_;
+    }
+    void add(const T_e* x, T_e value){
+        archive_.row(position_) = Eigen::Map<const Eigen::Matrix<T_e, 1, Eigen::Dynamic>>(x, T_dim);
+        norms_[position_] = archive_.row(position_).squaredNorm();
+        values_[position_] = value;
+        position_ = (position_ + 1) % capacity_;
+        size_ = std::min(size_ + 1, capacity_);
+    }
+    /**
+     * @brief predict the objective values of a batch of solutions
+     *
+     * @param x pointers to the solutions
+     * @param out predicted values
+     * @param n number of solutions
+     */
+    void predict(T_e** x, T_e* out, int n){
+        matrix_type queries(n, T_dim);
+        for(int i=0; i<n; i++)
+            queries.row(i) = Eigen::Map<const Eigen::Matrix<T_e, 1, Eigen::Dynamic>>(x[i], T_dim);
+        // squared distances |q|^2 - 2 q.a + |a|^2
+        matrix_type distances = -2.0 * queries * archive_.topRows(size_).transpose();
+        distances.rowwise() += norms_.head(size_).transpose();
+        distances.colwise() += queries.rowwise().squaredNorm();
+        const int k = std::min(k_, size_);
+        tbb::parallel_for(0, n, [&](int i){
+            std::vector<int> neighbors(size_);
+            std::iota(neighbors.begin(), neighbors.end(), 0);
+            std::partial_sort(neighbors.begin(), neighbors.begin() + k, neighbors.end(), [&](int a, int b){
+                return distances(i, a) < distances(i, b);
+            });
+            T_e weight_sum = 0.0, value_sum = 0.0;
+            for(int j=0; j<k; j++){
+                T_e d = std::max<T_e>(distances(i, neighbors[j]), 0.0);
+                T_e w = 1.0 / (d + std::numeric_limits<T_e>::epsilon());
+                weight_sum += w;
+                value_sum += w * values_[neighbors[j]];
+            }
+            out[i] = value_sum / weight_sum;
+        });
+    }
+};
+
+/**
+ * @brief surrogate-assisted pre-screening of candidates
+ *
+ * Candidates that the surrogate predicts to be worse than the solutions they would
+ * replace are not evaluated and get the maximum value, so they never replace a
+ * solution. The best predicted fraction of the candidates is always evaluated to
+ * keep the model honest. Every real evaluation is added to the model, so the
+ * candidates are evaluated exactly instead of being abandoned early.
+ */
+template<typename T_e, int T_dim>
+class surrogate_screen{
+protected:
+    knn_surrogate<T_e, T_dim> model_;
+    // fraction of the candidates that is always evaluated
+    T_e min_fraction_;
+    // number of archived solutions required before screening
+    int warmup_;
+    // number of screened candidates
+    long n_candidates_;
+    // number of real evaluations
+    long n_evaluations_;
+    std::vector<T_e*> candidates_;
+    std::vector<T_e> predicted_;
+    std::vector<int> order_;
+    std::vector<T_e*> selected_;
+    std::vector<T_e> selected_values_;
+    std::vector<T_e> thresholds_;
+
+public:
+    /**
+     * @param k number of neighbors
+     * @param capacity maximum number of archived solutions
+     * @param min_fraction fraction of the candidates that is always evaluated
+     * @param warmup number of archived solutions required before screening, 0 uses 16 times the number of neighbors
+     */
+    surrogate_screen(int k=8, int capacity=1024, T_e min_fraction=0.1, int warmup=0): model_(k, capacity){
+        this->min_fraction_ = min_fraction;
+        this->warmup_ = std::min((warmup > 0) ? warmup : 16 * model_.k(), capacity);
+        this->n_candidates_ = 0;
+        this->n_evaluations_ = 0;
+    }
+    // forget the archived solutions, e.g. when the optimized block changes
+    void reset(){
+        model_.reset();
+    }
+    long n_candidates() const{
+        return n_candidates_;
+    }
+    long n_evaluations() const{
+        return n_evaluations_;
+    }
+    // number of evaluations saved by the surrogate
+    long n_saved() const{
+        return n_candidates_ - n_evaluations_;
+    }
+    /**
+     * @brief evaluate the promising candidates within a range
+     *
+     * @param problem objective system
+     * @param candidates candidates container
+     * @param start first candidate
+     * @param end end of the range
+     * @param destination the container that receives the candidates
+     * @param one_to_one compare candidate i with solution i of the destination instead of its worst solution
+     */
+    void evaluate(system<T_e>* problem, basic_scontainer<T_e, T_dim>* candidates, int start, int end,
+                  basic_scontainer<T_e, T_dim>* destination, bool one_to_one=false){
+        const int n = end - start;
+        if(n <= 0)
+            return;
+        n_candidates_ += n;
+        candidates_.resize(n);
+        for(int i=0; i<n; i++)
+            candidates_[i] = candidates->particle(start + i);
+        T_e* values = candidates->values.data() + start;
+        acceptance_thresholds(destination, start, n, one_to_one, thresholds_);
+        if(model_.size() < warmup_){
+            problem->objective_batch(candidates_.data(), values, n);
+            for(int i=0; i<n; i++)
+                model_.add(candidates_[i], values[i]);
+            n_evaluations_ += n;
+            return;
+        }
+        predicted_.resize(n);
+        model_.predict(candidates_.data(), predicted_.data(), n);
+        // margin of each candidate over the solution it would replace
+        for(int i=0; i<n; i++)
+            predicted_[i] -= thresholds_[i];
+        order_.resize(n);
+        std::iota(order_.begin(), order_.end(), 0);
+        std::sort(order_.begin(), order_.end(), [this](int a, int b){
+            return this->predicted_[a] < this->predicted_[b];
+        });
+        int n_selected = std::clamp(static_cast<int>(std::ceil(min_fraction_ * n)), 1, n);
+        while(n_selected < n && predicted_[order_[n_selected]] < 0.0)
+            n_selected++;
+        selected_.resize(n_selected);
+        selected_values_.resize(n_selected);
+        for(int i=0; i<n_selected; i++)
+            selected_[i] = candidates_[order_[i]];
+        problem->objective_batch(selected_.data(), selected_values_.data(), n_selected);
+        std::fill(values, values + n, std::numeric_limits<T_e>::max());
+        for(int i=0; i<n_selected; i++){
+            values[order_[i]] = selected_values_[i];
+            model_.add(selected_[i], selected_values_[i]);
+        }
+        n_evaluations_ += n_selected;
+    }
+};
+
+/**
+ * @brief base class for strategies that can screen their candidates with a surrogate
+ *
+ */
+template<typename T_e, int T_dim>
+class surrogate_assisted{
+protected:
+    // shared screen owned by the runtime, null when screening is disabled
+    surrogate_screen<T_e, T_dim>* screen_ = nullptr;
+    // acceptance thresholds of the evaluated candidates
+    std::vector<T_e> thresholds_;
+    /**
+     * @brief evaluate candidates, only the promising ones if screening is enabled
+     * without screening, candidates are evaluated with their acceptance thresholds
+     * so that rejected candidates of bounded objectives cost a fraction of a full evaluation
+     *
+     * @param destination the container that receives the candidates
+     * @param one_to_one compare candidate i with solution i of the destination
+     */
+    void evaluate_candidates(system<T_e>* problem, basic_scontainer<T_e, T_dim>* candidates, int start, int end,
+                             basic_scontainer<T_e, T_dim>* destination, bool one_to_one=false){
+        if(screen_){
+            screen_->evaluate(problem, candidates, start, end, destination, one_to_one);
+            return;
+        }
+        acceptance_thresholds(destination, start, end - start, one_to_one, thresholds_);
+        candidates->evaluate_and_update_bounded(problem, start, end, thresholds_.data());
+    }
+
+public:
+    virtual ~surrogate_assisted() {}
+    void enable_surrogate(surrogate_screen<T_e, T_dim>* screen){
+        screen_ = screen;
+    }
+};
+
+}; // end of zagros
+}; // end of rocky
+#endif
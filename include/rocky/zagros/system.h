@@ -7,6 +7,8 @@
 #include<iostream>
 #include<string>
 #include<memory>
+#include<vector>
+#include<algorithm>
 
 #include<tbb/tbb.h>
 
@@ -20,6 +22,83 @@ template<typename T_e>
 class system{
 public:
     virtual T_e objective(T_e* params) = 0;
+    /**
+     * @brief evaluate a batch of solutions
+     * systems with a high per-call overhead can override this to evaluate
+     * the whole batch at once, the default evaluates the solutions in parallel.
+     * such systems should also override objective_batch_bounded
+     * 
+     * @param params pointers to the solutions
+     * @param values destination of the objective values
+     * @param n number of solutions
+     * @return ** void 
+     */
+    virtual void objective_batch(T_e** params, T_e* values, int n){
+        tbb::parallel_for(0, n, [&](int i){
+            values[i] = this->objective(params[i]);
+        });
+    }
+    /**
+     * @brief evaluate a solution which is only useful if its value does not exceed a threshold
+     * objectives that are sums of non-negative terms can stop as soon as the partial
+     * sum exceeds the threshold. the result must be exact if it is not greater than
+     * the threshold, otherwise it can be any value greater than the threshold
+     * 
+     * @param params solution
+     * @param threshold acceptance threshold
+     * @return ** T_e 
+     */
+    virtual T_e objective_bounded(T_e* params, T_e threshold){
+        return objective(params);
+    }
+    /**
+     * @brief evaluate a batch of solutions with their acceptance thresholds
+     * 
+     * @param params pointers to the solutions
+     * @param values destination of the objective values
+     * @param n number of solutions
+     * @param thresholds acceptance threshold of each solution
+     * @return ** void 
+     */
+    virtual void objective_batch_bounded(T_e** params, T_e* values, int n, const T_e* thresholds){
+        tbb::parallel_for(0, n, [&](int i){
+            values[i] = this->objective_bounded(params[i], thresholds[i]);
+        });
+    }
+    /**
+     * @brief evaluate a solution at a lower fidelity
+     * simulators can trade accuracy for time, e.g. with fewer time steps or a
+     * coarser mesh. fidelity 1.0 must give the same value as objective, the
+     * default ignores the fidelity
+     * 
+     * @param params solution
+     * @param fidelity fidelity in (0, 1]
+     * @return ** T_e 
+     */
+    virtual T_e objective_fidelity(T_e* params, T_e fidelity){
+        return objective(params);
+    }
+    /**
+     * @brief evaluate a batch of solutions at a lower fidelity
+     * 
+     * @param params pointers to the solutions
+     * @param values destination of the objective values
+     * @param n number of solutions
+     * @param fidelity fidelity in (0, 1]
+     * @return ** void 
+     */
+    virtual void objective_batch_fidelity(T_e** params, T_e* values, int n, T_e fidelity){
+        tbb::parallel_for(0, n, [&](int i){
+            values[i] = this->objective_fidelity(params[i], fidelity);
+        });
+    }
+    /**
+     * @brief whether objective_batch evaluates a batch faster than its solutions one by one
+     * wrappers such as blocked_system only build batches for such systems
+     * 
+     * @return ** bool 
+     */
+    virtual bool batched(){ return false;}
     /**
      * @brief lower bound specification
      * should be used when lower bound is same for all parameters
@@ -61,6 +140,49 @@ public:
     virtual void optimize_for_block(int* block_mask, int block_dim){}
 };
 
+/**
+ * @brief interface for systems whose objective is an average over data samples
+ * 
+ * A runtime can restrict the objective to a mini-batch of samples which is
+ * shared by all solutions until the next mini-batch is selected.
+ */
+template<typename T_e>
+class stochastic_objective{
+public:
+    virtual ~stochastic_objective() {}
+    /**
+     * @brief number of samples in the full data
+     * 
+     * @return ** long 
+     */
+    virtual long n_samples() = 0;
+    /**
+     * @brief restrict the objective to a subset of the samples
+     * must not be called while solutions are being evaluated
+     * 
+     * @param indices sorted indices of the samples
+     * @param n number of samples, 0 selects all samples
+     * @return ** void 
+     */
+    virtual void set_samples(const long* indices, int n) = 0;
+    /**
+     * @brief hint the subset that will be selected by the next call to set_samples
+     * the samples may be loaded in the background while the current subset is evaluated
+     * 
+     * @param indices sorted indices of the samples
+     * @param n number of samples
+     * @return ** void 
+     */
+    virtual void prefetch_samples(const long* indices, int n){}
+    /**
+     * @brief evaluate a solution on all samples regardless of the selected subset
+     * 
+     * @param params solution
+     * @return ** T_e 
+     */
+    virtual T_e objective_full(T_e* params) = 0;
+};
+
 /**
  * @brief a virtual system to implement blocked coordinate descent
  * 
@@ -76,6 +198,14 @@ public:
     system<T_e>* main_system_;
     // block mask
     int* bcd_mask_;
+    // number of full solutions passed to the main system at once
+    static constexpr int batch_chunk = 64;
+    // full solutions of a chunk, reused by each thread
+    struct chunk{
+        std::vector<T_e> solutions;
+        std::vector<T_e*> params;
+    };
+    tbb::enumerable_thread_specific<chunk> chunks_;
     
     int original_dim() const{
         return original_dim_;
@@ -104,6 +234,71 @@ public:
         // evaluate the full solution
         return main_system_->objective(full_solution);
     }
+    virtual T_e objective_bounded(T_e* partial, T_e threshold){
+        T_e* full_solution = this->solution_state_->local().data();
+        for(int i=0; i<block_dim_; i++)
+            full_solution[bcd_mask_[i]] = partial[i];
+        return main_system_->objective_bounded(full_solution, threshold);
+    }
+    virtual T_e objective_fidelity(T_e* partial, T_e fidelity){
+        T_e* full_solution = this->solution_state_->local().data();
+        for(int i=0; i<block_dim_; i++)
+            full_solution[bcd_mask_[i]] = partial[i];
+        return main_system_->objective_fidelity(full_solution, fidelity);
+    }
+    /**
+     * @brief complete partial solutions with the solution state of the calling thread
+     * 
+     * @param partials pointers to the partial solutions
+     * @param n number of solutions, at most batch_chunk
+     * @return ** T_e** pointers to the full solutions
+     */
+    T_e** complete(T_e** partials, int n){
+        std::vector<T_e>& state = this->solution_state_->local();
+        chunk& c = chunks_.local();
+        c.solutions.resize(static_cast<size_t>(batch_chunk) * original_dim_);
+        c.params.resize(batch_chunk);
+        tbb::parallel_for(0, n, [&](int p){
+            T_e* full_solution = c.solutions.data() + static_cast<size_t>(p) * original_dim_;
+            std::copy(state.begin(), state.end(), full_solution);
+            for(int i=0; i<block_dim_; i++)
+                full_solution[bcd_mask_[i]] = partials[p][i];
+            c.params[p] = full_solution;
+        });
+        return c.params.data();
+    }
+    // the partial solutions are completed in place unless the main system evaluates batches
+    virtual void objective_batch(T_e** partials, T_e* values, int n){
+        if(!main_system_->batched()){
+            system<T_e>::objective_batch(partials, values, n);
+            return;
+        }
+        for(int first=0; first<n; first+=batch_chunk){
+            const int m = std::min(batch_chunk, n - first);
+            main_system_->objective_batch(complete(partials + first, m), values + first, m);
+        }
+    }
+    virtual void objective_batch_bounded(T_e** partials, T_e* values, int n, const T_e* thresholds){
+        if(!main_system_->batched()){
+            system<T_e>::objective_batch_bounded(partials, values, n, thresholds);
+            return;
+        }
+        for(int first=0; first<n; first+=batch_chunk){
+            const int m = std::min(batch_chunk, n - first);
+            main_system_->objective_batch_bounded(complete(partials + first, m), values + first, m, thresholds + first);
+        }
+    }
+    virtual void objective_batch_fidelity(T_e** partials, T_e* values, int n, T_e fidelity){
+        if(!main_system_->batched()){
+            system<T_e>::objective_batch_fidelity(partials, values, n, fidelity);
+            return;
+        }
+        for(int first=0; first<n; first+=batch_chunk){
+            const int m = std::min(batch_chunk, n - first);
+            main_system_->objective_batch_fidelity(complete(partials + first, m), values + first, m, fidelity);
+        }
+    }
+    virtual bool batched(){ return main_system_->batched();}
     /**
      * @brief lower bound specification
      * should be used when lower bound is same for all parameters
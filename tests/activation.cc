@@ -3,6 +3,8 @@
 #include <random>
 #include <functional>
 #include <algorithm>
+#include <vector>
+#include <cmath>
 #include <rocky/etna/blocks.h>
 
 
@@ -27,3 +29,112 @@ TEST_CASE("Activations (double precision)", "[etna][double]") {
     };
 
 }
+
+
+// the element-wise relu written against the virtual interface
+template<typename T_e>
+class virtual_relu: public rocky::etna::act::elm_activation<T_e>{
+public:
+    virtual T_e eval(T_e elm){
+        return (elm > 0) ? elm : 0.0;
+    }
+};
+
+TEST_CASE("Static activations (single precision)", "[etna][float]") {
+    using namespace rocky;
+    const unsigned N_in = 4096;
+
+    std::random_device rd;
+    std::mt19937 rnd_gen(rd());
+    std::uniform_real_distribution<float> dist(-4.0, 4.0);
+    auto sampler = std::bind(dist, rnd_gen);
+
+    std::vector<float> X_in(N_in);
+    std::vector<float> X_out(N_in);
+    std::generate(X_in.begin(), X_in.end(), sampler);
+
+    SECTION("element-wise activations"){
+        etna::act::unit_step{}(X_in.data(), X_out.data(), N_in);
+        for(int i=0; i<N_in; i++)
+            REQUIRE(X_out[i] == ((X_in[i] >= 0) ? 1.0f : 0.0f));
+        etna::act::relu{}(X_in.data(), X_out.data(), N_in);
+        for(int i=0; i<N_in; i++)
+            REQUIRE(X_out[i] == std::max(X_in[i], 0.0f));
+        etna::act::leaky_relu<1, 10>{}(X_in.data(), X_out.data(), N_in);
+        for(int i=0; i<N_in; i++)
+            REQUIRE(std::abs(X_out[i] - ((X_in[i] > 0) ? X_in[i] : 0.1f * X_in[i])) < 1e-6f);
+        etna::act::tanh{}(X_in.data(), X_out.data(), N_in);
+        for(int i=0; i<N_in; i++)
+            REQUIRE(std::abs(X_out[i] - std::tanh(X_in[i])) < 1e-5f);
+        etna::act::sigmoid{}(X_in.data(), X_out.data(), N_in);
+        for(int i=0; i<N_in; i++)
+            REQUIRE(std::abs(X_out[i] - 1.0f / (1.0f + std::exp(-X_in[i]))) < 1e-5f);
+        etna::act::gelu{}(X_in.data(), X_out.data(), N_in);
+        for(int i=0; i<N_in; i++)
+            REQUIRE(std::abs(X_out[i] - 0.5f * X_in[i] * (1.0f + std::erf(X_in[i] / std::sqrt(2.0f)))) < 1e-2f);
+    }
+
+    SECTION("softmax"){
+        const int n_rows = 64;
+        Eigen::Map<Eigen::Matrix<float, n_rows, N_in / n_rows, Eigen::RowMajor>> M(X_out.data());
+        std::copy(X_in.begin(), X_in.end(), X_out.begin());
+        etna::act::softmax::apply(M);
+        for(int r=0; r<n_rows; r++){
+            REQUIRE(std::abs(M.row(r).sum() - 1.0f) < 1e-5f);
+            REQUIRE((M.row(r).array() > 0.0f).all());
+        }
+    }
+
+    SECTION("fused linear layer"){
+        const int B_in = 16, D_in = 64, D_out = 32;
+        etna::linear<float, B_in, D_in, D_out, etna::opt::bias> plain;
+        etna::linear<float, B_in, D_in, D_out, etna::opt::bias, etna::act::relu> fused;
+        std::vector<float> X_layer(plain.deduce_num_params());
+        std::generate(X_layer.begin(), X_layer.end(), sampler);
+        std::vector<float> X_ref(B_in * D_out), X_fused(B_in * D_out);
+        plain.feed(X_layer.data(), X_in.data(), X_ref.data());
+        etna::act::relu{}(X_ref.data(), B_in * D_out);
+        fused.feed(X_layer.data(), X_in.data(), X_fused.data());
+        for(int i=0; i<B_in * D_out; i++)
+            REQUIRE(std::abs(X_fused[i] - X_ref[i]) < 1e-4f);
+
+        BENCHMARK("Linear and ReLU (separate)") {
+            plain.feed(X_layer.data(), X_in.data(), X_ref.data());
+            etna::act::relu{}(X_ref.data(), B_in * D_out);
+            return;
+        };
+        BENCHMARK("Linear and ReLU (fused)") {
+            fused.feed(X_layer.data(), X_in.data(), X_fused.data());
+            return;
+        };
+    }
+
+    SECTION("virtual and static activations"){
+        etna::act::step<float> step_fn;
+        virtual_relu<float> relu_fn;
+        BENCHMARK("Step function (virtual)") {
+            step_fn(X_in.data(), X_out.data(), N_in);
+            return;
+        };
+        BENCHMARK("Step function (static)") {
+            etna::act::unit_step{}(X_in.data(), X_out.data(), N_in);
+            return;
+        };
+        BENCHMARK("ReLU (virtual)") {
+            relu_fn(X_in.data(), X_out.data(), N_in);
+            return;
+        };
+        BENCHMARK("ReLU (static)") {
+            etna::act::relu{}(X_in.data(), X_out.data(), N_in);
+            return;
+        };
+        BENCHMARK("Tanh (static)") {
+            etna::act::tanh{}(X_in.data(), X_out.data(), N_in);
+            return;
+        };
+        BENCHMARK("GELU (static)") {
+            etna::act::gelu{}(X_in.data(), X_out.data(), N_in);
+            return;
+        };
+    }
+}
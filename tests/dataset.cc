@@ -0,0 +1,96 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <rocky/etna/dataset.h>
+#include <rocky/zagros/etna_system.h>
+
+
+TEST_CASE("Memory-mapped dataset", "[dataset][etna][rocky]"){
+    using namespace rocky;
+
+    typedef double solution_type;
+    typedef etna::mlp<solution_type, 1, 16, 4, 2, 8, etna::opt::bias, etna::act::tanh> model_type;
+
+    // not a multiple of the model's batch size
+    const int n_rows = 100;
+    const int in_dim = model_type::deduce_in_dim();
+    const int out_dim = model_type::deduce_out_dim();
+
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<solution_type> dist(-1.0, 1.0);
+    std::vector<solution_type> inputs(n_rows * in_dim), targets(n_rows * out_dim);
+    std::generate(inputs.begin(), inputs.end(), [&](){ return dist(rng); });
+    std::generate(targets.begin(), targets.end(), [&](){ return dist(rng); });
+
+    auto dir = std::filesystem::temp_directory_path();
+    std::string csv_path = (dir / "rocky_dataset_test.csv").string();
+    std::string bin_path = (dir / "rocky_dataset_test.bin").string();
+    {
+        std::ofstream csv(csv_path);
+        csv.precision(17);
+        csv << "x0,x1,x2,x3,y0,y1\n";
+        for(int r=0; r<n_rows; r++){
+            for(int c=0; c<in_dim; c++)
+                csv << inputs[r * in_dim + c] << ",";
+            for(int c=0; c<out_dim; c++)
+                csv << targets[r * out_dim + c] << ((c + 1 < out_dim) ? "," : "\n");
+        }
+    }
+    REQUIRE(etna::convert_csv<solution_type>(csv_path, bin_path, in_dim, out_dim, true) == n_rows);
+    etna::mapped_dataset<solution_type> dataset(bin_path);
+
+    SECTION("conversion"){
+        REQUIRE(dataset.n_rows() == n_rows);
+        REQUIRE(dataset.in_dim() == in_dim);
+        REQUIRE(dataset.out_dim() == out_dim);
+        for(int i=0; i<n_rows * in_dim; i++)
+            REQUIRE(dataset.inputs()[i] == inputs[i]);
+        for(int i=0; i<n_rows * out_dim; i++)
+            REQUIRE(dataset.targets()[i] == targets[i]);
+        // zero-copy views of a batch
+        auto batch = dataset.inputs(10, 5);
+        REQUIRE(batch.rows() == 5);
+        REQUIRE(batch.cols() == in_dim);
+        REQUIRE(batch.data() == dataset.inputs() + 10 * in_dim);
+        REQUIRE(batch(2, 3) == inputs[12 * in_dim + 3]);
+        REQUIRE(dataset.targets(10, 5)(4, 1) == targets[14 * out_dim + 1]);
+        // the element type must match the file
+        REQUIRE_THROWS_AS(etna::mapped_dataset<float>(bin_path), std::runtime_error);
+        REQUIRE_THROWS_AS(etna::mapped_dataset<solution_type>(csv_path), std::runtime_error);
+    }
+    SECTION("training objective"){
+        const int dim = model_type::deduce_num_params();
+        std::vector<solution_type> params(dim);
+        std::generate(params.begin(), params.end(), [&](){ return dist(rng); });
+        zagros::etna_system<solution_type, model_type> in_memory({inputs.data(), targets.data(), n_rows, in_dim, out_dim});
+        zagros::etna_system<solution_type, model_type> mapped(dataset.view());
+        REQUIRE(std::abs(mapped.objective(params.data()) - in_memory.objective(params.data())) < 1e-12);
+        // the dimensions of the dataset must match the model
+        typedef etna::mlp<solution_type, 1, 16, 4, 3, 8, etna::opt::bias, etna::act::tanh> wide_model_type;
+        REQUIRE_THROWS_AS((zagros::etna_system<solution_type, wide_model_type>(dataset.view())), std::invalid_argument);
+        REQUIRE_THROWS_AS((zagros::etna_system<solution_type, model_type>({inputs.data(), targets.data(), n_rows, in_dim + 1, out_dim})), std::invalid_argument);
+
+        // a prefetched mini-batch equals a mini-batch gathered on demand
+        std::vector<long> first{1, 5, 17, 40, 41, 99}, second{0, 2, 3, 50, 60, 70, 80, 90};
+        in_memory.set_samples(second.data(), second.size());
+        solution_type expected = in_memory.objective(params.data());
+        mapped.set_samples(first.data(), first.size());
+        mapped.prefetch_samples(second.data(), second.size());
+        mapped.objective(params.data());
+        mapped.set_samples(second.data(), second.size());
+        REQUIRE(std::abs(mapped.objective(params.data()) - expected) < 1e-12);
+        // a hint that is not followed is ignored
+        mapped.prefetch_samples(first.data(), first.size());
+        mapped.set_samples(second.data(), second.size());
+        REQUIRE(std::abs(mapped.objective(params.data()) - expected) < 1e-12);
+    }
+    std::remove(csv_path.c_str());
+    std::remove(bin_path.c_str());
+}
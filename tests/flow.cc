@@ -3,6 +3,11 @@
 #include <catch2/benchmark/catch_benchmark.hpp>
 #include <rocky/zagros/benchmark.h>
 #include <rocky/zagros/flow.h>
+#include <rocky/zagros/etna_system.h>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <limits>
 
 
 TEST_CASE("Creating a flow", "[flow][zagros][rocky]"){
@@ -28,4 +33,60 @@ TEST_CASE("Creating a flow", "[flow][zagros][rocky]"){
     zagros::basic_runtime<swarm_type, dim, block_dim> runtime(&problem);
     runtime.run(f1);
 
-};
\ No newline at end of file
+    // a full-covariance EDA on a container smaller than the block selects all of its solutions
+    const int small_dim = 30;
+    zagros::benchmark::sphere<swarm_type> small_problem(small_dim);
+    auto f2 = container::create("B", 20)
+              >> init::uniform("B")
+              >> run::n_times(5, eda::mvn::full_cov("B"));
+    zagros::basic_runtime<swarm_type, small_dim> small_runtime(&small_problem);
+    small_runtime.run(f2);
+    auto small_cnt = small_runtime.storage.container("B");
+    for(int p=0; p<small_cnt->n_particles(); p++)
+        REQUIRE(small_cnt->values[p] < std::numeric_limits<swarm_type>::max());
+
+    // diagonal and low-rank EDAs with a chosen selection size
+    auto f3 = container::create("C", 40)
+              >> init::uniform("C")
+              >> run::n_times(5, eda::mvn::diagonal("C", 0, 10)
+                                 >> eda::mvn::low_rank("C", 4, 0, 10));
+    small_runtime.run(f3);
+    auto selected_cnt = small_runtime.storage.container("C");
+    for(int p=0; p<selected_cnt->n_particles(); p++)
+        REQUIRE(selected_cnt->values[p] < std::numeric_limits<swarm_type>::max());
+};
+TEST_CASE("Stochastic objective", "[flow][zagros][rocky]"){
+    using namespace rocky;
+
+    typedef double solution_type;
+    typedef etna::mlp<solution_type, 1, 16, 4, 1, 8> model_type;
+
+    const int dim = model_type::deduce_num_params();
+    const int n_rows = 500;
+
+    using namespace zagros::dena;
+
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<solution_type> dist(-1.0, 1.0);
+    std::vector<solution_type> inputs(n_rows * model_type::deduce_in_dim());
+    std::vector<solution_type> targets(n_rows * model_type::deduce_out_dim());
+    std::generate(inputs.begin(), inputs.end(), [&](){ return dist(rng); });
+    std::generate(targets.begin(), targets.end(), [&](){ return dist(rng); });
+    zagros::etna_system<solution_type, model_type> problem({inputs.data(), targets.data(), n_rows, model_type::deduce_in_dim(), model_type::deduce_out_dim()});
+
+    auto f1 = container::create("A", 20)
+              >> init::uniform("A")
+              >> run::n_times(10, stochastic::minibatch("A", 16, 2.0, 64)
+                                  >> mutate::gaussian("A", 4, 0.0, 0.1));
+
+    zagros::basic_runtime<solution_type, dim> runtime(&problem);
+    runtime.enable_best_rescoring();
+    runtime.run(f1);
+
+    // the mini-batch grows from 16 to its maximum size
+    REQUIRE(runtime.storage.minibatch.size() == 64);
+    REQUIRE(std::is_sorted(runtime.storage.minibatch.begin(), runtime.storage.minibatch.end()));
+    // the best solution is scored on all samples
+    auto best = runtime.storage.container("__best__");
+    REQUIRE(best->values[0] == problem.objective_full(best->particle(0)));
+};
@@ -3,6 +3,9 @@
 #include <random>
 #include <functional>
 #include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cmath>
 #include <rocky/etna/blocks.h>
 
 
@@ -162,4 +165,285 @@ TEST_CASE("MLP Layer (single precision, bias)", "[mlp][float]") {
 
         return;
     };   
-}
\ No newline at end of file
+}
+
+TEST_CASE("MLP workspace (double precision, bias)", "[mlp][double]") {
+    using namespace rocky;
+    const unsigned in_dim = 64;
+    const unsigned out_dim = 16;
+    const unsigned hidden_dim = 8;
+    const unsigned in_num = 16;
+    const unsigned layers_num = 3;
+
+    typedef etna::mlp<double, layers_num, in_num, in_dim, out_dim, hidden_dim, etna::opt::bias> net_type;
+    net_type net;
+    static_assert(net_type::deduce_workspace_size() >= 2 * in_num * hidden_dim);
+
+    std::random_device rd;
+    std::mt19937 rnd_gen(rd());
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    auto sampler = std::bind(dist, rnd_gen);
+
+    std::vector<double> X_in(in_num * in_dim);
+    std::vector<double> X_net(net.deduce_num_params());
+    std::vector<double> X_out(in_num * out_dim);
+    std::vector<double> X_ref(in_num * out_dim);
+    std::generate(X_in.begin(), X_in.end(), sampler);
+    std::generate(X_net.begin(), X_net.end(), sampler);
+
+    etna::workspace<double> ws(net.deduce_workspace_size());
+    REQUIRE(reinterpret_cast<std::uintptr_t>(ws.reserve(net.deduce_workspace_size())) % etna::workspace<double>::alignment == 0);
+    net.feed(X_net.data(), X_in.data(), X_out.data(), ws.reserve(net.deduce_workspace_size()));
+    net.feed(X_net.data(), X_in.data(), X_ref.data());
+    REQUIRE(X_out == X_ref);
+
+    BENCHMARK("Forward Pass (workspace)") {
+        net.feed(X_net.data(), X_in.data(), X_out.data(), ws.reserve(net.deduce_workspace_size()));
+        return;
+    };
+}
+
+
+TEST_CASE("MLP population forward pass (single precision, bias)", "[mlp][float]") {
+    using namespace rocky;
+    const unsigned in_dim = 64;
+    const unsigned out_dim = 4;
+    const unsigned hidden_dim = 16;
+    const unsigned in_num = 64;
+    const unsigned layers_num = 1;
+    const int n_networks = 100;
+
+    typedef etna::mlp<float, layers_num, in_num, in_dim, out_dim, hidden_dim, etna::opt::bias> net_type;
+    net_type net;
+
+    std::random_device rd;
+    std::mt19937 rnd_gen(rd());
+    std::uniform_real_distribution<float> dist(-1.0, 1.0);
+    auto sampler = std::bind(dist, rnd_gen);
+
+    std::vector<float> X_in(in_num * in_dim);
+    std::vector<float> X_net(n_networks * net.deduce_num_params());
+    std::vector<float> X_out(n_networks * in_num * out_dim);
+    std::vector<float> X_ref(n_networks * in_num * out_dim);
+    std::generate(X_in.begin(), X_in.end(), sampler);
+    std::generate(X_net.begin(), X_net.end(), sampler);
+    std::vector<float*> net_ptrs(n_networks), out_ptrs(n_networks);
+    for(int p=0; p<n_networks; p++){
+        net_ptrs[p] = X_net.data() + p * net.deduce_num_params();
+        out_ptrs[p] = X_out.data() + p * in_num * out_dim;
+    }
+
+    etna::workspace<float> ws(net.deduce_population_workspace_size());
+    net.feed_population(net_ptrs.data(), n_networks, X_in.data(), out_ptrs.data(), ws.reserve(net.deduce_population_workspace_size()));
+    for(int p=0; p<n_networks; p++)
+        net.feed(net_ptrs[p], X_in.data(), X_ref.data() + p * in_num * out_dim, ws.reserve(net.deduce_workspace_size()));
+    for(int i=0; i<X_out.size(); i++)
+        REQUIRE(std::abs(X_out[i] - X_ref[i]) <= 1e-4f * (1.0f + std::abs(X_ref[i])));
+
+    BENCHMARK("Forward Pass (one network at a time)") {
+        for(int p=0; p<n_networks; p++)
+            net.feed(net_ptrs[p], X_in.data(), out_ptrs[p], ws.reserve(net.deduce_workspace_size()));
+        return;
+    };
+    BENCHMARK("Forward Pass (population)") {
+        net.feed_population(net_ptrs.data(), n_networks, X_in.data(), out_ptrs.data(), ws.reserve(net.deduce_population_workspace_size()));
+        return;
+    };
+}
+
+
+TEST_CASE("Dynamic linear layer (single precision, bias)", "[linear][float]") {
+    using namespace rocky;
+    const unsigned in_dim = 64;
+    const unsigned out_dim = 32;
+    const unsigned in_num = 128;
+
+    etna::linear<float, in_num, in_dim, out_dim, etna::opt::bias, etna::act::relu> fixed;
+    etna::dynamic_linear<float, etna::act::relu> layer(in_dim, out_dim, etna::opt::bias);
+    REQUIRE(layer.num_params() == fixed.deduce_num_params());
+
+    std::random_device rd;
+    std::mt19937 rnd_gen(rd());
+    std::uniform_real_distribution<float> dist(-1.0, 1.0);
+    auto sampler = std::bind(dist, rnd_gen);
+
+    std::vector<float> X_in(in_num * in_dim);
+    std::vector<float> X_layer(layer.num_params());
+    std::vector<float> X_out(in_num * out_dim);
+    std::vector<float> X_ref(in_num * out_dim);
+    std::generate(X_in.begin(), X_in.end(), sampler);
+    std::generate(X_layer.begin(), X_layer.end(), sampler);
+
+    fixed.feed(X_layer.data(), X_in.data(), X_ref.data());
+    layer.feed(X_layer.data(), X_in.data(), X_out.data(), in_num);
+    for(int i=0; i<X_out.size(); i++)
+        REQUIRE(std::abs(X_out[i] - X_ref[i]) <= 1e-4f * (1.0f + std::abs(X_ref[i])));
+
+    // several row blocks followed by a partial one
+    const int n_rows = 2 * layer.row_block + 88;
+    std::vector<float> X_rows(n_rows * in_dim);
+    std::vector<float> X_rows_out(n_rows * out_dim);
+    std::generate(X_rows.begin(), X_rows.end(), sampler);
+    layer.feed(X_layer.data(), X_rows.data(), X_rows_out.data(), n_rows);
+    for(int r=0; r<n_rows; r++)
+        for(int o=0; o<out_dim; o++){
+            float expected = X_layer[layer.num_params_weights() + o];
+            for(int i=0; i<in_dim; i++)
+                expected += X_rows[r * in_dim + i] * X_layer[i * out_dim + o];
+            expected = std::max(expected, 0.0f);
+            REQUIRE(std::abs(X_rows_out[r * out_dim + o] - expected) <= 1e-4f * (1.0f + std::abs(expected)));
+        }
+
+    BENCHMARK("Forward Pass (fixed)") {
+        fixed.feed(X_layer.data(), X_in.data(), X_out.data());
+        return;
+    };
+    BENCHMARK("Forward Pass (dynamic)") {
+        layer.feed(X_layer.data(), X_in.data(), X_out.data(), in_num);
+        return;
+    };
+}
+
+
+TEST_CASE("Dynamic MLP (single precision, bias)", "[mlp][float]") {
+    using namespace rocky;
+    const unsigned in_dim = 64;
+    const unsigned out_dim = 8;
+    const unsigned hidden_dim = 32;
+    const unsigned in_num = 64;
+    const unsigned layers_num = 2;
+
+    typedef etna::mlp<float, layers_num, in_num, in_dim, out_dim, hidden_dim, etna::opt::bias, etna::act::tanh> net_type;
+    net_type fixed;
+    etna::dynamic_mlp<float, etna::act::tanh> net(layers_num, in_dim, out_dim, hidden_dim, etna::opt::bias);
+    // the parameter layout is the layout of the fixed-size model
+    REQUIRE(net.num_params() == net_type::deduce_num_params());
+    for(int l=0; l<=net.num_layers(); l++)
+        REQUIRE(net.layer_offset(l) == net_type::deduce_layer_offset(l));
+
+    std::random_device rd;
+    std::mt19937 rnd_gen(rd());
+    std::uniform_real_distribution<float> dist(-1.0, 1.0);
+    auto sampler = std::bind(dist, rnd_gen);
+
+    std::vector<float> X_in(in_num * in_dim);
+    std::vector<float> X_net(net.num_params());
+    std::vector<float> X_out(in_num * out_dim);
+    std::vector<float> X_ref(in_num * out_dim);
+    std::generate(X_in.begin(), X_in.end(), sampler);
+    std::generate(X_net.begin(), X_net.end(), sampler);
+    fixed.feed(X_net.data(), X_in.data(), X_ref.data());
+
+    SECTION("same batch size"){
+        net.feed(X_net.data(), X_in.data(), X_out.data(), in_num);
+        for(int i=0; i<X_out.size(); i++)
+            REQUIRE(std::abs(X_out[i] - X_ref[i]) <= 1e-4f * (1.0f + std::abs(X_ref[i])));
+    }
+    SECTION("smaller batch size"){
+        // samples are independent, so a prefix of the batch gives a prefix of the output
+        const int n_rows = 13;
+        std::fill(X_out.begin(), X_out.end(), 0.0f);
+        net.feed(X_net.data(), X_in.data(), X_out.data(), n_rows);
+        for(int i=0; i<n_rows * out_dim; i++)
+            REQUIRE(std::abs(X_out[i] - X_ref[i]) <= 1e-4f * (1.0f + std::abs(X_ref[i])));
+        REQUIRE(X_out[n_rows * out_dim] == 0.0f);
+    }
+    SECTION("benchmark"){
+        etna::workspace<float> ws(std::max<long>(net_type::deduce_workspace_size(), net.workspace_size(in_num)));
+        BENCHMARK("Forward Pass (fixed)") {
+            fixed.feed(X_net.data(), X_in.data(), X_out.data(), ws.reserve(net_type::deduce_workspace_size()));
+            return;
+        };
+        BENCHMARK("Forward Pass (dynamic)") {
+            net.feed(X_net.data(), X_in.data(), X_out.data(), in_num, ws.reserve(net.workspace_size(in_num)));
+            return;
+        };
+    }
+}
+
+
+TEST_CASE("Sequential model (single precision, bias)", "[sequential][float]") {
+    using namespace rocky;
+    const unsigned in_dim = 32;
+    const unsigned out_dim = 4;
+    const unsigned hidden_dim = 16;
+    const unsigned in_num = 32;
+
+    std::random_device rd;
+    std::mt19937 rnd_gen(rd());
+    std::uniform_real_distribution<float> dist(-1.0, 1.0);
+    auto sampler = std::bind(dist, rnd_gen);
+
+    std::vector<float> X_in(in_num * in_dim);
+    std::vector<float> X_out(in_num * out_dim);
+    std::vector<float> X_ref(in_num * out_dim);
+    std::generate(X_in.begin(), X_in.end(), sampler);
+
+    SECTION("same layout as mlp"){
+        typedef etna::mlp<float, 1, in_num, in_dim, out_dim, hidden_dim, etna::opt::bias, etna::act::tanh> mlp_type;
+        typedef etna::sequential<float,
+            etna::linear<float, in_num, in_dim, hidden_dim, etna::opt::bias, etna::act::tanh>,
+            etna::linear<float, in_num, hidden_dim, hidden_dim, etna::opt::bias, etna::act::tanh>,
+            etna::linear<float, in_num, hidden_dim, out_dim, etna::opt::bias>> net_type;
+        static_assert(net_type::deduce_num_params() == mlp_type::deduce_num_params());
+        static_assert(net_type::deduce_layer_offset(2) == mlp_type::deduce_layer_offset(2));
+        static_assert(net_type::deduce_buffer_size() == in_num * hidden_dim);
+        mlp_type reference;
+        net_type net;
+        std::vector<float> X_net(net.deduce_num_params());
+        std::generate(X_net.begin(), X_net.end(), sampler);
+        reference.feed(X_net.data(), X_in.data(), X_ref.data());
+        net.feed(X_net.data(), X_in.data(), X_out.data());
+        for(int i=0; i<X_out.size(); i++)
+            REQUIRE(std::abs(X_out[i] - X_ref[i]) <= 1e-5f * (1.0f + std::abs(X_ref[i])));
+
+        etna::workspace<float> ws(std::max(net.deduce_workspace_size(), reference.deduce_workspace_size()));
+        BENCHMARK("Forward Pass (mlp)") {
+            reference.feed(X_net.data(), X_in.data(), X_out.data(), ws.reserve(reference.deduce_workspace_size()));
+            return;
+        };
+        BENCHMARK("Forward Pass (sequential)") {
+            net.feed(X_net.data(), X_in.data(), X_out.data(), ws.reserve(net.deduce_workspace_size()));
+            return;
+        };
+    }
+    SECTION("mixed layers"){
+        typedef etna::linear<float, in_num, in_dim, hidden_dim, etna::opt::bias> l1_type;
+        typedef etna::layer_norm<float, in_num, hidden_dim> norm_type;
+        typedef etna::activation_layer<float, in_num, hidden_dim, etna::act::relu> relu_type;
+        typedef etna::mlp<float, 1, in_num, hidden_dim, out_dim, hidden_dim, etna::opt::bias, etna::act::gelu> head_type;
+        typedef etna::sequential<float, l1_type, norm_type, relu_type, head_type> net_type;
+        static_assert(net_type::deduce_num_layers() == 4);
+        static_assert(net_type::deduce_layer_offset(1) == l1_type::deduce_num_params());
+        static_assert(net_type::deduce_layer_offset(2) == net_type::deduce_layer_offset(1) + 2 * hidden_dim);
+        static_assert(net_type::deduce_layer_offset(3) == net_type::deduce_layer_offset(2));
+        static_assert(net_type::deduce_num_params() == net_type::deduce_layer_offset(3) + head_type::deduce_num_params());
+        static_assert(net_type::deduce_workspace_size() >= 2 * in_num * hidden_dim + head_type::deduce_workspace_size());
+
+        net_type net;
+        std::vector<float> X_net(net.deduce_num_params());
+        std::generate(X_net.begin(), X_net.end(), sampler);
+        // reference: layer by layer
+        std::vector<float> H1(in_num * hidden_dim), H2(in_num * hidden_dim);
+        l1_type().feed(X_net.data(), X_in.data(), H1.data());
+        norm_type().feed(X_net.data() + net.deduce_layer_offset(1), H1.data(), H2.data());
+        for(int r=0; r<in_num; r++){
+            float mean = 0.0f, var = 0.0f;
+            for(int c=0; c<hidden_dim; c++)
+                mean += H1[r * hidden_dim + c] / hidden_dim;
+            for(int c=0; c<hidden_dim; c++)
+                var += (H1[r * hidden_dim + c] - mean) * (H1[r * hidden_dim + c] - mean) / hidden_dim;
+            for(int c=0; c<hidden_dim; c++){
+                float expected = (H1[r * hidden_dim + c] - mean) / std::sqrt(var + 1e-5f) * X_net[net.deduce_layer_offset(1) + c]
+                               + X_net[net.deduce_layer_offset(1) + hidden_dim + c];
+                REQUIRE(std::abs(H2[r * hidden_dim + c] - expected) <= 1e-4f * (1.0f + std::abs(expected)));
+            }
+        }
+        for(auto& h: H2)
+            h = std::max(h, 0.0f);
+        head_type().feed(X_net.data() + net.deduce_layer_offset(3), H2.data(), X_ref.data());
+        net.feed(X_net.data(), X_in.data(), X_out.data());
+        for(int i=0; i<X_out.size(); i++)
+            REQUIRE(std::abs(X_out[i] - X_ref[i]) <= 1e-4f * (1.0f + std::abs(X_ref[i])));
+    }
+}
@@ -0,0 +1,40 @@
+/*
+    a stand-in objective worker for testing rocky::zagros::process_system
+    evaluates the Rastrigin function
+    --delay-ms n : sleep n milliseconds for each solution
+    --hang-after n : stop responding after n solutions
+    --exit-after n : exit after n solutions
+*/
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <rocky/zagros/benchmark.h>
+#include <rocky/zagros/process_system.h>
+
+int main(int argc, char* argv[]){
+    using namespace rocky;
+    int delay_ms = 0;
+    int hang_after = -1;
+    int exit_after = -1;
+    for(int i=1; i+1<argc; i+=2){
+        if(std::strcmp(argv[i], "--delay-ms") == 0)
+            delay_ms = std::atoi(argv[i+1]);
+        else if(std::strcmp(argv[i], "--hang-after") == 0)
+            hang_after = std::atoi(argv[i+1]);
+        else if(std::strcmp(argv[i], "--exit-after") == 0)
+            exit_after = std::atoi(argv[i+1]);
+    }
+    int n_solutions = 0;
+    return zagros::objective_worker::serve([&](const double* x, int dim){
+        if(hang_after >= 0 && n_solutions >= hang_after)
+            std::this_thread::sleep_for(std::chrono::hours(1));
+        if(exit_after >= 0 && n_solutions >= exit_after)
+            std::exit(1);
+        n_solutions++;
+        if(delay_ms > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+        zagros::benchmark::rastrigin<double> problem(dim);
+        return problem.objective(const_cast<double*>(x));
+    });
+}
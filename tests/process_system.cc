@@ -0,0 +1,109 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <signal.h>
+#include <rocky/zagros/benchmark.h>
+#include <rocky/zagros/containers/scontainer.h>
+#include <rocky/zagros/strategies/init.h>
+#include <rocky/zagros/process_system.h>
+
+#ifndef ROCKY_OBJECTIVE_WORKER
+#define ROCKY_OBJECTIVE_WORKER "./objective_worker"
+#endif
+
+
+TEST_CASE("out-of-process objective evaluation", "[system][zagros][rocky]"){
+    using namespace rocky;
+
+    typedef double solution_type;
+
+    const int n_particles = 100;
+    const int dim = 50;
+
+    zagros::benchmark::rastrigin<solution_type> reference(dim);
+    zagros::basic_scontainer<solution_type, dim> container(n_particles, n_particles);
+    container.allocate();
+    zagros::uniform_init_strategy<solution_type, dim> init(&reference, &container);
+    init.apply();
+
+    auto require_reference_values = [&](){
+        for(int p=0; p<n_particles; p++)
+            REQUIRE(std::abs(container.values[p] - reference.objective(container.particle(p))) < 1e-9);
+    };
+
+    SECTION("batched evaluation"){
+        zagros::process_system<solution_type> problem({ROCKY_OBJECTIVE_WORKER}, dim, 4, 8, 2);
+        container.evaluate_and_update(&problem);
+        require_reference_values();
+        REQUIRE(problem.n_restarts() == 0);
+        BENCHMARK("batched evaluation"){
+            container.evaluate_and_update(&problem);
+        };
+    }
+    SECTION("blocked batches"){
+        // a block of every third parameter, the others come from the solution state
+        std::vector<int> mask;
+        for(int i=0; i<dim; i+=3)
+            mask.push_back(i);
+        const int block_dim = mask.size();
+        std::vector<solution_type> state_solution(container.particle(0), container.particle(0) + dim);
+        tbb::enumerable_thread_specific<std::vector<solution_type>> state(state_solution);
+        std::vector<solution_type> partials(n_particles * block_dim), expected(n_particles), values(n_particles);
+        std::vector<solution_type*> partial_ptrs(n_particles);
+        for(int p=0; p<n_particles; p++){
+            partial_ptrs[p] = partials.data() + p * block_dim;
+            std::vector<solution_type> full(state_solution);
+            for(int i=0; i<block_dim; i++){
+                partial_ptrs[p][i] = container.particle(p)[mask[i]];
+                full[mask[i]] = partial_ptrs[p][i];
+            }
+            expected[p] = reference.objective(full.data());
+        }
+        // batches of the process system span several chunks of full solutions
+        zagros::process_system<solution_type> problem({ROCKY_OBJECTIVE_WORKER}, dim, 4, 8, 2);
+        REQUIRE(problem.batched());
+        REQUIRE(!reference.batched());
+        for(auto main_system: std::vector<zagros::system<solution_type>*>{&problem, &reference}){
+            zagros::blocked_system<solution_type> blocked(main_system, dim, block_dim, mask.data());
+            blocked.set_solution_state(&state);
+            REQUIRE(blocked.batched() == main_system->batched());
+            std::fill(values.begin(), values.end(), 0.0);
+            blocked.objective_batch(partial_ptrs.data(), values.data(), n_particles);
+            for(int p=0; p<n_particles; p++)
+                REQUIRE(std::abs(values[p] - expected[p]) < 1e-9);
+            std::vector<solution_type> thresholds(n_particles, std::numeric_limits<solution_type>::max());
+            std::fill(values.begin(), values.end(), 0.0);
+            blocked.objective_batch_bounded(partial_ptrs.data(), values.data(), n_particles, thresholds.data());
+            for(int p=0; p<n_particles; p++)
+                REQUIRE(std::abs(values[p] - expected[p]) < 1e-9);
+            std::fill(values.begin(), values.end(), 0.0);
+            blocked.objective_batch_fidelity(partial_ptrs.data(), values.data(), n_particles, 1.0);
+            for(int p=0; p<n_particles; p++)
+                REQUIRE(std::abs(values[p] - expected[p]) < 1e-9);
+        }
+    }
+    SECTION("restarting failed workers"){
+        zagros::process_system<solution_type> hanging({ROCKY_OBJECTIVE_WORKER, "--hang-after", "20"}, dim, 2, 8, 2, 200, 100);
+        container.evaluate_and_update(&hanging);
+        require_reference_values();
+        REQUIRE(hanging.n_restarts() > 0);
+
+        zagros::process_system<solution_type> exiting({ROCKY_OBJECTIVE_WORKER, "--exit-after", "20"}, dim, 2, 8, 2, 200, 100);
+        container.evaluate_and_update(&exiting);
+        require_reference_values();
+        REQUIRE(exiting.n_restarts() > 0);
+        // writing to the exited workers does not change the signal handling of the process
+        struct sigaction pipe_action;
+        sigaction(SIGPIPE, nullptr, &pipe_action);
+        REQUIRE(pipe_action.sa_handler == SIG_DFL);
+    }
+    SECTION("failing batches"){
+        zagros::process_system<solution_type> problem({ROCKY_OBJECTIVE_WORKER, "--hang-after", "0"}, dim, 1, 50, 1, 50, 2);
+        container.evaluate_and_update(&problem);
+        for(int p=0; p<n_particles; p++)
+            REQUIRE(container.values[p] == std::numeric_limits<solution_type>::max());
+    }
+};
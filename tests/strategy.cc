@@ -5,16 +5,75 @@
 #include <functional>
 #include <algorithm>
 #include <list>
+#include <limits>
+#include <vector>
 #include <rocky/zagros/containers/scontainer.h>
 #include <rocky/zagros/strategies/init.h>
 #include <rocky/zagros/strategies/genetic.h>
 #include <rocky/zagros/strategies/eda.h>
+#include <rocky/zagros/strategies/cmaes.h>
 #include <rocky/zagros/strategies/differential_evolution.h>
 #include <rocky/zagros/strategies/container_manipulation.h>
 
 #include <rocky/zagros/benchmark.h>
 
 
+// exposes the cholesky factor of the incremental EDA
+template<typename T_e, int T_dim>
+class incremental_mvn_probe: public rocky::zagros::eda_incremental_mvn<T_e, T_dim>{
+public:
+    using rocky::zagros::eda_incremental_mvn<T_e, T_dim>::eda_incremental_mvn;
+    // relative error of s * L * L^T with respect to the smoothed covariance and the decayed ridge of a singular covariance
+    T_e factor_error(){
+        typename rocky::zagros::eda_mutivariate_normal<T_e, T_dim>::eigen_matrix cov_mat(this->cov_mem_.data(), T_dim, T_dim);
+        Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic> L = this->llt_.matrixL();
+        Eigen::Matrix<T_e, Eigen::Dynamic, Eigen::Dynamic> expected = cov_mat;
+        expected.diagonal().array() += this->factor_scale_ * this->ridge_;
+        return (this->factor_scale_ * L * L.transpose() - expected).norm() / expected.norm();
+    }
+    // the last step recomputed the factor from scratch
+    bool refactorized(){
+        return this->steps_ == 0;
+    }
+    std::vector<T_e> covariance(){
+        return this->cov_mem_;
+    }
+    void refactorize_now(){
+        this->refactorize();
+    }
+};
+
+// a problem without any progress, so every run of a restarting strategy stalls
+template<typename T_e>
+class flat_problem: public rocky::zagros::system<T_e>{
+public:
+    virtual T_e objective(T_e* x){
+        return 1.0;
+    }
+    virtual T_e lower_bound(){ return -1.0; }
+    virtual T_e upper_bound(){ return 1.0; }
+};
+
+// best value of a covariance adaptation strategy on a small sphere after some generations
+template<template<typename, int> class T_strategy>
+double cmaes_sphere_best(int n_generations){
+    using namespace rocky;
+    const int small_dim = 10;
+    zagros::benchmark::sphere<double> sphere(small_dim);
+    zagros::basic_scontainer<double, small_dim> container(20, 20);
+    container.allocate();
+    zagros::basic_scontainer<double, small_dim> population(48, 48);
+    population.allocate();
+    zagros::uniform_init_strategy<double, small_dim> init(&sphere, &container);
+    init.apply();
+    container.evaluate_and_update(&sphere);
+    T_strategy<double, small_dim> str(&sphere, &container, &population, zagros::cmaes_restart::none);
+    for(int g=0; g<n_generations; g++)
+        str.apply();
+    return container.best_min();
+}
+
+
 TEST_CASE("strategy", "[strategy][zagros][rocky]"){
 
     using namespace rocky;
@@ -81,6 +140,151 @@ TEST_CASE("strategy", "[strategy][zagros][rocky]"){
         };
     };
 
+    SECTION("pipelined differential evolution"){
+        zagros::basic_differential_evolution<container_type, dim> str(&problem, &container, &candidates);
+        str.enable_pipeline(&problem, 8);
+        // values written by concurrent stages match their particles and the best never gets worse
+        for(int step=0; step<5; step++){
+            container_type best = container.best_min();
+            str.apply();
+            REQUIRE(container.best_min() <= best);
+        }
+        for(int p=0; p<n_particles; p++)
+            REQUIRE(std::abs(container.values[p] - problem.objective(container.particle(p))) <= 1e-12 * std::abs(container.values[p]));
+        BENCHMARK("pipelined differential evolution"){
+            str.apply();
+        };
+    };
+
+    SECTION("steady-state evaluation"){
+        zagros::basic_differential_evolution<container_type, dim> de_str(&problem, &container, &candidates);
+        zagros::gaussian_mutation<container_type, dim> mutation_str(&problem, &container, &candidates);
+        zagros::steady_state_evaluator<container_type, dim> evaluator(&problem);
+        evaluator.add_operator(&de_str);
+        evaluator.add_operator(&mutation_str);
+        // replacements by concurrent workers keep values and particles consistent
+        for(int step=0; step<5; step++){
+            container_type best = container.best_min();
+            evaluator.run(candidates.n_particles());
+            REQUIRE(container.best_min() <= best);
+        }
+        for(int p=0; p<n_particles; p++)
+            REQUIRE(std::abs(container.values[p] - problem.objective(container.particle(p))) <= 1e-12 * std::abs(container.values[p]));
+
+        // an EDA is prepared again by one worker while the others wait, its estimation runs parallel loops
+        const int small_dim = 10;
+        zagros::benchmark::sphere<container_type> sphere(small_dim);
+        zagros::basic_scontainer<container_type, small_dim> sphere_container(n_particles, group_size);
+        sphere_container.allocate();
+        zagros::basic_scontainer<container_type, small_dim> sphere_candidates(n_particles, group_size);
+        sphere_candidates.allocate();
+        zagros::uniform_init_strategy<container_type, small_dim> sphere_init(&sphere, &sphere_container);
+        sphere_init.apply();
+        sphere_container.evaluate_and_update(&sphere);
+        zagros::eda_mutivariate_normal<container_type, small_dim> eda_str(&sphere, &sphere_container, &sphere_candidates, n_particles / 2);
+        zagros::gaussian_mutation<container_type, small_dim> sphere_mutation(&sphere, &sphere_container, &sphere_candidates);
+        zagros::steady_state_evaluator<container_type, small_dim> sphere_evaluator(&sphere);
+        sphere_evaluator.add_operator(&eda_str);
+        sphere_evaluator.add_operator(&sphere_mutation);
+        container_type sphere_best = sphere_container.best_min();
+        sphere_evaluator.run(20 * n_particles);
+        REQUIRE(sphere_container.best_min() < sphere_best);
+        for(int p=0; p<n_particles; p++)
+            REQUIRE(std::abs(sphere_container.values[p] - sphere.objective(sphere_container.particle(p))) <= 1e-12 * std::abs(sphere_container.values[p]));
+
+        BENCHMARK("steady-state evaluation"){
+            return evaluator.run(candidates.n_particles());
+        };
+    };
+
+    SECTION("surrogate-assisted differential evolution"){
+        zagros::surrogate_screen<container_type, dim> screen(8, 256, 0.1, 100);
+        zagros::basic_differential_evolution<container_type, dim> str(&problem, &container, &candidates);
+        str.enable_surrogate(&screen);
+        BENCHMARK("surrogate-assisted differential evolution"){
+            str.apply();
+        };
+        REQUIRE(screen.n_evaluations() >= 100);
+        REQUIRE(screen.n_evaluations() + screen.n_saved() == screen.n_candidates());
+
+        // on a smooth problem the surrogate rejects candidates once it is warmed up
+        const int small_dim = 10;
+        const container_type max_value = std::numeric_limits<container_type>::max();
+        zagros::benchmark::sphere<container_type> sphere(small_dim);
+        zagros::basic_scontainer<container_type, small_dim> sphere_container(n_particles, group_size);
+        sphere_container.allocate();
+        zagros::basic_scontainer<container_type, small_dim> sphere_candidates(n_particles, group_size);
+        sphere_candidates.allocate();
+        zagros::uniform_init_strategy<container_type, small_dim> sphere_init(&sphere, &sphere_container);
+        sphere_init.apply();
+        sphere_container.evaluate_and_update(&sphere);
+        zagros::surrogate_screen<container_type, small_dim> sphere_screen(8, 256, 0.1, 100);
+        zagros::basic_differential_evolution<container_type, small_dim> sphere_str(&sphere, &sphere_container, &sphere_candidates);
+        sphere_str.enable_surrogate(&sphere_screen);
+        for(int step=0; step<20; step++){
+            long saved = sphere_screen.n_saved();
+            sphere_str.apply();
+            // every screened candidate gets the maximum value
+            int n_screened = 0;
+            for(int c=0; c<n_particles; c++)
+                if(sphere_candidates.values[c] == max_value)
+                    n_screened++;
+            REQUIRE(n_screened == sphere_screen.n_saved() - saved);
+            // and never replaces a solution
+            for(int p=0; p<n_particles; p++){
+                REQUIRE(sphere_container.values[p] < max_value);
+                REQUIRE(std::abs(sphere_container.values[p] - sphere.objective(sphere_container.particle(p))) <= 1e-12 * std::abs(sphere_container.values[p]));
+                for(int c=0; c<n_particles; c++)
+                    if(sphere_candidates.values[c] == max_value)
+                        REQUIRE(!std::equal(sphere_container.particle(p), sphere_container.particle(p) + small_dim, sphere_candidates.particle(c)));
+            }
+        }
+        REQUIRE(sphere_screen.n_saved() > 0);
+
+        // the prediction for an archived solution is its stored value
+        zagros::knn_surrogate<container_type, small_dim> model(4, 64);
+        for(int p=0; p<32; p++)
+            model.add(sphere_container.particle(p), sphere_container.values[p]);
+        std::vector<container_type*> queries{sphere_container.particle(0), sphere_container.particle(17), sphere_container.particle(31)};
+        std::vector<container_type> predicted(queries.size());
+        model.predict(queries.data(), predicted.data(), queries.size());
+        REQUIRE(std::abs(predicted[0] - sphere_container.values[0]) <= 1e-9 * sphere_container.values[0]);
+        REQUIRE(std::abs(predicted[1] - sphere_container.values[17]) <= 1e-9 * sphere_container.values[17]);
+        REQUIRE(std::abs(predicted[2] - sphere_container.values[31]) <= 1e-9 * sphere_container.values[31]);
+    };
+
+    SECTION("successive halving"){
+        zagros::benchmark::least_squares<container_type> mf_problem(270, dim);
+        zagros::uniform_init_strategy<container_type, dim> candidates_init(&mf_problem, &candidates);
+        candidates_init.apply();
+        zagros::successive_halving_eval_strategy<container_type, dim> str(&mf_problem, &candidates, 1.0/9.0, 3.0);
+        str.apply();
+        // 100 candidates at 1/9, 34 at 1/3 and 12 at full fidelity
+        REQUIRE(std::abs(str.cost() - (100.0/9.0 + 34.0/3.0 + 12.0)) < 1e-9);
+        int n_survivors = 0;
+        for(int p=0; p<n_particles; p++){
+            if(candidates.values[p] == std::numeric_limits<container_type>::max())
+                continue;
+            n_survivors++;
+            REQUIRE(candidates.values[p] == mf_problem.objective(candidates.particle(p)));
+        }
+        REQUIRE(n_survivors == 12);
+        BENCHMARK("successive halving"){
+            str.apply();
+        };
+    };
+
+    SECTION("adaptive differential evolution"){
+        zagros::de_success_history<container_type> history;
+        history.resize(10);
+        zagros::adaptive_differential_evolution<container_type, dim> str(&problem, &container, &candidates,
+                                                                         zagros::de_mutation::current_to_pbest_1,
+                                                                         zagros::de_adaptation::shade, &history);
+        BENCHMARK("adaptive differential evolution"){
+            str.apply();
+        };
+    };
+
     SECTION("estimation of distribution (MVN)"){
         int samples = 100;
         zagros::eda_mutivariate_normal<container_type, dim> str(&problem, &container, &candidates, samples);
@@ -89,4 +293,98 @@ TEST_CASE("strategy", "[strategy][zagros][rocky]"){
         };
     };
 
+    SECTION("estimation of distribution (incremental MVN)"){
+        int samples = 100;
+        // the factor tracks the smoothed covariance between and right after refactorizations
+        incremental_mvn_probe<container_type, dim> probe(&problem, &container, &candidates, samples, 0.2, 4);
+        int n_refactorized = 0, n_updated = 0;
+        for(int step=0; step<9; step++){
+            probe.apply();
+            REQUIRE(probe.factor_error() < 1e-8);
+            if(probe.refactorized())
+                n_refactorized++;
+            else
+                n_updated++;
+        }
+        REQUIRE(n_refactorized >= 2);
+        REQUIRE(n_updated >= 2);
+        // the ridge of a singular covariance does not accumulate in the running covariance
+        const int small_dim = 10;
+        zagros::benchmark::sphere<container_type> sphere(small_dim);
+        zagros::basic_scontainer<container_type, small_dim> collapsed(20, 20);
+        collapsed.allocate();
+        zagros::basic_scontainer<container_type, small_dim> collapsed_candidates(20, 20);
+        collapsed_candidates.allocate();
+        for(int p=0; p<20; p++)
+            std::fill(collapsed.particle(p), collapsed.particle(p) + small_dim, 0.5);
+        collapsed.evaluate_and_update(&sphere);
+        incremental_mvn_probe<container_type, small_dim> singular(&sphere, &collapsed, &collapsed_candidates, 5, 0.2, 4);
+        singular.estimate_distribution();
+        singular.decompose();
+        std::vector<container_type> covariance = singular.covariance();
+        singular.refactorize_now();
+        singular.refactorize_now();
+        REQUIRE(singular.covariance() == covariance);
+        zagros::eda_incremental_mvn<container_type, dim> str(&problem, &container, &candidates, samples, 0.2, 10);
+        BENCHMARK("estimation of distribution (incremental MVN)"){
+            str.apply();
+        };
+    };
+
+    SECTION("estimation of distribution (diagonal and low-rank MVN)"){
+        int samples = 50;
+        zagros::eda_diagonal_normal<container_type, dim> diagonal_str(&problem, &container, &candidates, samples);
+        BENCHMARK("estimation of distribution (diagonal MVN)"){
+            diagonal_str.apply();
+        };
+        zagros::eda_low_rank_normal<container_type, dim> low_rank_str(&problem, &container, &candidates, samples, 8);
+        BENCHMARK("estimation of distribution (low-rank MVN)"){
+            low_rank_str.apply();
+        };
+    };
+
+    SECTION("covariance matrix adaptation"){
+        REQUIRE(cmaes_sphere_best<zagros::cmaes_strategy>(300) < 1e-5);
+        {
+            // a stalled run is restarted with a doubled population
+            const int small_dim = 10;
+            flat_problem<container_type> flat;
+            zagros::basic_scontainer<container_type, small_dim> flat_container(20, 20);
+            flat_container.allocate();
+            zagros::basic_scontainer<container_type, small_dim> flat_population(48, 48);
+            flat_population.allocate();
+            zagros::uniform_init_strategy<container_type, small_dim> flat_init(&flat, &flat_container);
+            flat_init.apply();
+            flat_container.evaluate_and_update(&flat);
+            zagros::cmaes_strategy<container_type, small_dim> restarting(&flat, &flat_container, &flat_population, zagros::cmaes_restart::ipop);
+            restarting.apply();
+            const int lambda = restarting.population_size();
+            for(int g=0; g<5 && restarting.n_restarts() == 0; g++)
+                restarting.apply();
+            REQUIRE(restarting.n_restarts() == 1);
+            REQUIRE(restarting.population_size() == 2 * lambda);
+        }
+        zagros::basic_scontainer<container_type, dim> population(48, 48);
+        population.allocate();
+        zagros::cmaes_strategy<container_type, dim> str(&problem, &container, &population, zagros::cmaes_restart::ipop);
+        BENCHMARK("covariance matrix adaptation"){
+            str.apply();
+        };
+    };
+
+    SECTION("separable and limited-memory covariance adaptation"){
+        REQUIRE(cmaes_sphere_best<zagros::sep_cmaes_strategy>(300) < 1e-5);
+        REQUIRE(cmaes_sphere_best<zagros::lm_ma_es_strategy>(300) < 1e-5);
+        zagros::basic_scontainer<container_type, dim> population(48, 48);
+        population.allocate();
+        zagros::sep_cmaes_strategy<container_type, dim> sep_str(&problem, &container, &population);
+        BENCHMARK("separable covariance matrix adaptation"){
+            sep_str.apply();
+        };
+        zagros::lm_ma_es_strategy<container_type, dim> lm_str(&problem, &container, &population);
+        BENCHMARK("limited-memory matrix adaptation"){
+            lm_str.apply();
+        };
+    };
+
 };
\ No newline at end of file
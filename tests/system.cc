@@ -0,0 +1,377 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <numeric>
+#include <cstdint>
+#include <rocky/zagros/benchmark.h>
+#include <rocky/zagros/containers/scontainer.h>
+#include <rocky/zagros/strategies/init.h>
+#include <rocky/zagros/cached_system.h>
+#include <rocky/zagros/neuroevolution.h>
+#include <rocky/zagros/etna_system.h>
+
+
+TEST_CASE("objective cache", "[system][zagros][rocky]"){
+    using namespace rocky;
+
+    typedef double solution_type;
+
+    const int n_particles = 100;
+    const int dim = 100;
+
+    zagros::benchmark::rastrigin<solution_type> problem(dim);
+    zagros::basic_scontainer<solution_type, dim> container(n_particles, n_particles);
+    container.allocate();
+    zagros::uniform_init_strategy<solution_type, dim> init(&problem, &container);
+    init.apply();
+
+    SECTION("exact duplicates"){
+        zagros::cached_system<solution_type> cached(&problem, dim, 1024);
+        container.evaluate_and_update(&cached);
+        REQUIRE(cached.hits() == 0);
+        REQUIRE(cached.misses() == n_particles);
+        auto values = container.values;
+        container.evaluate_and_update(&cached);
+        REQUIRE(cached.hits() == n_particles);
+        REQUIRE(container.values == values);
+        // a changed solution is evaluated again
+        container.particle(0)[0] += 1e-6;
+        REQUIRE(cached.objective(container.particle(0)) == problem.objective(container.particle(0)));
+        REQUIRE(cached.misses() == n_particles + 1);
+        BENCHMARK("cached evaluation"){
+            container.evaluate_and_update(&cached);
+        };
+    }
+    SECTION("quantized solutions"){
+        zagros::cached_system<solution_type> cached(&problem, dim, 1024, 1e-3);
+        container.evaluate_and_update(&cached);
+        // move the solution towards the center of its quantization cell
+        for(int i=0; i<dim; i++)
+            container.particle(0)[i] = 1e-3 * std::round(container.particle(0)[i] / 1e-3) + 1e-5;
+        cached.objective(container.particle(0));
+        auto misses = cached.misses();
+        REQUIRE(cached.objective(container.particle(0)) == cached.objective(container.particle(0)));
+        container.particle(0)[0] += 1e-5;
+        cached.objective(container.particle(0));
+        REQUIRE(cached.misses() == misses);
+    }
+    SECTION("eviction"){
+        // only 64 of the solutions fit in the cache
+        zagros::cached_system<solution_type> cached(&problem, dim, 64, 0.0, 4);
+        container.evaluate_and_update(&cached);
+        container.evaluate_and_update(&cached);
+        REQUIRE(cached.hits() <= 64);
+        REQUIRE(cached.hits() + cached.misses() == 2 * n_particles);
+        cached.clear();
+        REQUIRE(cached.hit_rate() == 0.0);
+    }
+};
+
+
+TEST_CASE("bounded evaluation", "[system][zagros][rocky]"){
+    using namespace rocky;
+
+    typedef double solution_type;
+
+    const int n_particles = 100;
+    const int dim = 100;
+
+    zagros::benchmark::rastrigin<solution_type> problem(dim, 1.0);
+    zagros::basic_scontainer<solution_type, dim> container(n_particles, n_particles);
+    container.allocate();
+    zagros::uniform_init_strategy<solution_type, dim> init(&problem, &container);
+    init.apply();
+    container.evaluate_and_update(&problem);
+
+    // a threshold between the two middle values, half of the particles are accepted
+    auto values = container.values;
+    std::sort(values.begin(), values.end());
+    solution_type median = 0.5 * (values[n_particles / 2 - 1] + values[n_particles / 2]);
+    std::vector<solution_type> thresholds(n_particles, median);
+
+    SECTION("early abandoning"){
+        zagros::basic_scontainer<solution_type, dim> bounded(n_particles, n_particles);
+        bounded.allocate();
+        for(int p=0; p<n_particles; p++)
+            std::copy(container.particle(p), container.particle(p) + dim, bounded.particle(p));
+        bounded.evaluate_and_update_bounded(&problem, 0, n_particles, thresholds.data());
+        for(int p=0; p<n_particles; p++){
+            // accepted values are summed in the same order as the full objective
+            if(container.values[p] <= thresholds[p])
+                REQUIRE(bounded.values[p] == container.values[p]);
+            else
+                REQUIRE(bounded.values[p] > thresholds[p]);
+        }
+        BENCHMARK("bounded evaluation"){
+            bounded.evaluate_and_update_bounded(&problem, 0, n_particles, thresholds.data());
+        };
+    }
+    SECTION("partial values are not cached"){
+        zagros::cached_system<solution_type> cached(&problem, dim, 1024);
+        container.evaluate_and_update_bounded(&cached, 0, n_particles, thresholds.data());
+        container.evaluate_and_update(&cached);
+        REQUIRE(cached.hits() == n_particles / 2);
+    }
+};
+
+// mean squared output of a small network, a stand-in for a real loss
+template<typename T_e, typename T_model>
+class output_energy: public rocky::zagros::neuroevolution_system<T_e, T_model>{
+public:
+    output_energy(T_e* input): rocky::zagros::neuroevolution_system<T_e, T_model>(input){}
+    virtual T_e loss(T_e* output){
+        T_e S = 0.0;
+        for(int i=0; i<T_model::deduce_out_size(); i++)
+            S += output[i] * output[i];
+        return S / T_model::deduce_out_size();
+    }
+};
+
+TEST_CASE("neuroevolution", "[system][zagros][rocky]"){
+    using namespace rocky;
+
+    typedef float solution_type;
+    typedef etna::mlp<solution_type, 1, 32, 64, 4, 16> model_type;
+
+    const int n_particles = 100;
+    const int dim = model_type::deduce_num_params();
+
+    std::vector<solution_type> input(model_type::deduce_in_size());
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<solution_type> dist(-1.0, 1.0);
+    std::generate(input.begin(), input.end(), [&](){ return dist(rng); });
+
+    output_energy<solution_type, model_type> problem(input.data());
+    zagros::basic_scontainer<solution_type, dim> container(n_particles, n_particles);
+    container.allocate();
+    zagros::uniform_init_strategy<solution_type, dim> init(&problem, &container);
+    init.apply();
+
+    SECTION("population-batched evaluation"){
+        container.evaluate_and_update(&problem);
+        for(int p=0; p<n_particles; p++){
+            solution_type value = problem.objective(container.particle(p));
+            REQUIRE(std::abs(container.values[p] - value) <= 1e-4f * (1.0f + value));
+        }
+        BENCHMARK("population-batched evaluation"){
+            container.evaluate_and_update(&problem);
+        };
+    }
+};
+
+TEST_CASE("etna system", "[system][zagros][rocky]"){
+    using namespace rocky;
+
+    typedef double solution_type;
+    typedef etna::mlp<solution_type, 1, 16, 8, 3, 12, etna::opt::bias, etna::act::tanh> model_type;
+
+    const int n_particles = 50;
+    const int dim = model_type::deduce_num_params();
+    // not a multiple of the model's batch size
+    const int n_rows = 100;
+
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<solution_type> dist(-1.0, 1.0);
+    std::vector<solution_type> inputs(n_rows * model_type::deduce_in_dim());
+    std::vector<solution_type> targets(n_rows * model_type::deduce_out_dim());
+    std::generate(inputs.begin(), inputs.end(), [&](){ return dist(rng); });
+
+    // targets are the outputs of a teacher network
+    model_type model;
+    std::vector<solution_type> teacher(dim);
+    std::generate(teacher.begin(), teacher.end(), [&](){ return dist(rng); });
+    std::vector<solution_type> chunk_in(model_type::deduce_in_size()), chunk_out(model_type::deduce_out_size());
+    for(int first=0; first<n_rows; first+=model_type::deduce_batch_size()){
+        int rows = std::min(model_type::deduce_batch_size(), n_rows - first);
+        std::fill(chunk_in.begin(), chunk_in.end(), 0.0);
+        std::copy(inputs.begin() + first * model_type::deduce_in_dim(), inputs.begin() + (first + rows) * model_type::deduce_in_dim(), chunk_in.begin());
+        model.feed(teacher.data(), chunk_in.data(), chunk_out.data());
+        std::copy(chunk_out.begin(), chunk_out.begin() + rows * model_type::deduce_out_dim(), targets.begin() + first * model_type::deduce_out_dim());
+    }
+    zagros::dataset_view<solution_type> data{inputs.data(), targets.data(), n_rows, model_type::deduce_in_dim(), model_type::deduce_out_dim()};
+
+    zagros::basic_scontainer<solution_type, dim> container(n_particles, n_particles);
+    container.allocate();
+
+    SECTION("mean squared error"){
+        zagros::etna_system<solution_type, model_type> problem(data);
+        REQUIRE(problem.objective(teacher.data()) < 1e-20);
+        zagros::uniform_init_strategy<solution_type, dim> init(&problem, &container);
+        init.apply();
+        container.evaluate_and_update(&problem);
+        for(int p=0; p<n_particles; p++)
+            REQUIRE(std::abs(container.values[p] - problem.objective(container.particle(p))) < 1e-9);
+        BENCHMARK("etna system evaluation"){
+            container.evaluate_and_update(&problem);
+        };
+    }
+    SECTION("cross-entropy"){
+        // one-hot targets of the teacher's arg max
+        std::vector<solution_type> labels(targets.size(), 0.0);
+        for(int r=0; r<n_rows; r++){
+            auto row = targets.begin() + r * model_type::deduce_out_dim();
+            labels[std::distance(targets.begin(), std::max_element(row, row + model_type::deduce_out_dim()))] = 1.0;
+        }
+        zagros::etna_system<solution_type, model_type, etna::loss::cross_entropy> classifier({inputs.data(), labels.data(), n_rows, model_type::deduce_in_dim(), model_type::deduce_out_dim()});
+        // reference: log-softmax of the teacher outputs
+        solution_type expected = 0.0;
+        for(int r=0; r<n_rows; r++){
+            auto z = targets.begin() + r * model_type::deduce_out_dim();
+            solution_type lse = 0.0;
+            for(int c=0; c<model_type::deduce_out_dim(); c++)
+                lse += std::exp(z[c]);
+            for(int c=0; c<model_type::deduce_out_dim(); c++)
+                expected -= labels[r * model_type::deduce_out_dim() + c] * (z[c] - std::log(lse));
+        }
+        expected /= n_rows;
+        REQUIRE(std::abs(classifier.objective(teacher.data()) - expected) < 1e-9);
+    }
+    SECTION("per-layer bounds"){
+        zagros::etna_system<solution_type, model_type> problem(data);
+        problem.glorot_bounds();
+        problem.set_layer_bounds(2, -0.5, 0.25);
+        REQUIRE(std::abs(problem.lower_bound(0) + std::sqrt(6.0 / (8 + 12))) < 1e-12);
+        REQUIRE(std::abs(problem.upper_bound(model_type::deduce_layer_offset(1)) - std::sqrt(6.0 / (12 + 12))) < 1e-12);
+        REQUIRE(problem.lower_bound(model_type::deduce_layer_offset(2)) == -0.5);
+        REQUIRE(problem.upper_bound(dim - 1) == 0.25);
+        zagros::uniform_init_strategy<solution_type, dim> init(&problem, &container);
+        init.apply();
+        for(int p=0; p<n_particles; p++)
+            for(int d=model_type::deduce_layer_offset(2); d<dim; d++)
+                REQUIRE((container.particle(p)[d] >= -0.5 && container.particle(p)[d] <= 0.25));
+    }
+    SECTION("reduced precision"){
+        zagros::etna_system<solution_type, model_type> problem(data);
+        zagros::etna_system<solution_type, model_type, etna::loss::mse, std::int8_t> problem_int8(data);
+        zagros::etna_system<solution_type, model_type, etna::loss::mse, etna::bf16> problem_bf16(data);
+        zagros::uniform_init_strategy<solution_type, dim> init_params(&problem, &container);
+        init_params.apply();
+
+        // per-layer scales bound the rounding error of each parameter
+        etna::quantized_params<solution_type, std::int8_t> q_int8(etna::quantized_params<solution_type, std::int8_t>::layer_offsets<model_type>());
+        etna::quantized_params<solution_type, etna::bf16> q_bf16(etna::quantized_params<solution_type, etna::bf16>::layer_offsets<model_type>());
+        q_int8.resize(1);
+        q_bf16.resize(1);
+        q_int8.quantize(0, container.particle(0));
+        q_bf16.quantize(0, container.particle(0));
+        std::vector<solution_type> restored(dim);
+        q_int8.dequantize(0, restored.data());
+        for(int l=0; l<model_type::deduce_num_layers(); l++)
+            for(int d=model_type::deduce_layer_offset(l); d<model_type::deduce_layer_offset(l + 1); d++)
+                REQUIRE(std::abs(restored[d] - container.particle(0)[d]) <= 0.5 * q_int8.scale(0, l) + 1e-12);
+        q_bf16.dequantize(0, restored.data());
+        for(int d=0; d<dim; d++)
+            REQUIRE(std::abs(restored[d] - container.particle(0)[d]) <= std::abs(container.particle(0)[d]) / 128);
+
+        // batched and single evaluations agree and stay close to full precision
+        std::vector<solution_type*> batch(n_particles);
+        for(int p=0; p<n_particles; p++)
+            batch[p] = container.particle(p);
+        std::vector<solution_type> full(n_particles), reduced(n_particles);
+        problem.objective_batch(batch.data(), full.data(), n_particles);
+        problem_int8.enable_validation(1.0);
+        problem_int8.objective_batch(batch.data(), reduced.data(), n_particles);
+        REQUIRE(problem_int8.max_deviation() > 0.0);
+        q_int8.resize(n_particles);
+        for(int p=0; p<n_particles; p++){
+            // the quantized parameters are fed as they are, a full-precision network with the dequantized parameters gives the same value
+            q_int8.quantize(p, container.particle(p));
+            q_int8.dequantize(p, restored.data());
+            REQUIRE(std::abs(reduced[p] - problem.objective(restored.data())) < 1e-9);
+            REQUIRE(std::abs(reduced[p] - problem_int8.objective(container.particle(p))) < 1e-9);
+            REQUIRE(std::abs(reduced[p] - full[p]) <= problem_int8.max_deviation() + 1e-12);
+            REQUIRE(std::abs(reduced[p] - full[p]) < 0.05 * full[p]);
+        }
+        problem_bf16.objective_batch(batch.data(), reduced.data(), n_particles);
+        for(int p=0; p<n_particles; p++)
+            REQUIRE(std::abs(reduced[p] - full[p]) < 0.05 * full[p]);
+
+        BENCHMARK("etna system evaluation (full precision)"){
+            problem.objective_batch(batch.data(), full.data(), n_particles);
+        };
+        BENCHMARK("etna system evaluation (int8)"){
+            problem_int8.enable_validation(-1.0);
+            problem_int8.objective_batch(batch.data(), reduced.data(), n_particles);
+        };
+        BENCHMARK("etna system evaluation (bf16)"){
+            problem_bf16.objective_batch(batch.data(), reduced.data(), n_particles);
+        };
+    }
+    SECTION("prefix caching"){
+        zagros::etna_system<solution_type, model_type> reference(data);
+        zagros::etna_system<solution_type, model_type> problem(data);
+        zagros::uniform_init_strategy<solution_type, dim> init(&problem, &container);
+        init.apply();
+        // a block in the output layer, all particles share the parameters of the other layers
+        const int first = model_type::deduce_layer_offset(2);
+        std::vector<int> mask(dim - first);
+        std::iota(mask.begin(), mask.end(), first);
+        for(int p=1; p<n_particles; p++)
+            std::copy(container.particle(0), container.particle(0) + first, container.particle(p));
+        std::vector<solution_type*> batch(n_particles);
+        for(int p=0; p<n_particles; p++)
+            batch[p] = container.particle(p);
+        std::vector<solution_type> expected(n_particles), values(n_particles);
+        reference.objective_batch(batch.data(), expected.data(), n_particles);
+
+        problem.optimize_for_block(mask.data(), mask.size());
+        problem.objective_batch(batch.data(), values.data(), n_particles);
+        REQUIRE(problem.prefix_cached());
+        for(int p=0; p<n_particles; p++){
+            REQUIRE(std::abs(values[p] - expected[p]) < 1e-9);
+            REQUIRE(std::abs(problem.objective(container.particle(p)) - expected[p]) < 1e-9);
+        }
+        // a solution with another prefix is evaluated from the input
+        container.particle(1)[0] += 0.5;
+        REQUIRE(std::abs(problem.objective(container.particle(1)) - reference.objective(container.particle(1))) < 1e-9);
+        problem.objective_batch(batch.data(), values.data(), n_particles);
+        REQUIRE(std::abs(values[1] - reference.objective(container.particle(1))) < 1e-9);
+        REQUIRE(std::abs(values[n_particles - 1] - expected[n_particles - 1]) < 1e-9);
+        container.particle(1)[0] -= 0.5;
+
+        // through a blocked system
+        std::vector<solution_type> partials(n_particles * mask.size());
+        std::vector<solution_type*> partial_ptrs(n_particles);
+        for(int p=0; p<n_particles; p++){
+            partial_ptrs[p] = partials.data() + p * mask.size();
+            for(int i=0; i<mask.size(); i++)
+                partial_ptrs[p][i] = container.particle(p)[mask[i]];
+        }
+        tbb::enumerable_thread_specific<std::vector<solution_type>> state(std::vector<solution_type>(container.particle(0), container.particle(0) + dim));
+        zagros::blocked_system<solution_type> blocked(&problem, dim, mask.size(), mask.data());
+        blocked.set_solution_state(&state);
+        blocked.optimization_for_block();
+        blocked.objective_batch(partial_ptrs.data(), values.data(), n_particles);
+        for(int p=0; p<n_particles; p++)
+            REQUIRE(std::abs(values[p] - expected[p]) < 1e-9);
+
+        BENCHMARK("etna system evaluation (from the input)"){
+            reference.objective_batch(batch.data(), values.data(), n_particles);
+        };
+        BENCHMARK("etna system evaluation (cached prefix)"){
+            problem.objective_batch(batch.data(), values.data(), n_particles);
+        };
+
+        // data above the capacity is fed from the input
+        problem.set_prefix_capacity(n_rows - 1);
+        problem.optimize_for_block(mask.data(), mask.size());
+        problem.objective_batch(batch.data(), values.data(), n_particles);
+        REQUIRE(!problem.prefix_cached());
+        for(int p=0; p<n_particles; p++)
+            REQUIRE(std::abs(values[p] - expected[p]) < 1e-9);
+        // while a mini-batch within the capacity is cached
+        std::vector<long> rows(n_rows / 2);
+        for(int r=0; r<rows.size(); r++)
+            rows[r] = 2 * r + 1;
+        reference.set_samples(rows.data(), rows.size());
+        reference.objective_batch(batch.data(), expected.data(), n_particles);
+        problem.set_samples(rows.data(), rows.size());
+        problem.objective_batch(batch.data(), values.data(), n_particles);
+        REQUIRE(problem.prefix_cached());
+        for(int p=0; p<n_particles; p++)
+            REQUIRE(std::abs(values[p] - expected[p]) < 1e-9);
+    }
+};
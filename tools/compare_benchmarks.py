@@ -0,0 +1,45 @@
+#    Copyright (C) 2022 Amirabbas Asadi , All Rights Reserved
+#    distributed under Apache-2.0 license
+
+import json
+import click
+
+
+def load_benchmarks(path):
+  with open(path) as fp:
+    report = json.load(fp)
+  return report['context'], {b['name']: b for b in report['benchmarks']}
+
+
+@click.command()
+@click.argument('baseline', type=click.Path(exists=True))
+@click.argument('contender', type=click.Path(exists=True))
+@click.option('--threshold', default=0.1, help='relative slowdown reported as a regression')
+@click.option('--metric', default='median_time', help='time field used for the comparison')
+def compare(baseline, contender, threshold, metric):
+  """compare two json reports produced by the benchmark targets"""
+  base_ctx, base = load_benchmarks(baseline)
+  cont_ctx, cont = load_benchmarks(contender)
+  click.echo('baseline : {} ({})'.format(base_ctx.get('commit', ''), base_ctx.get('date', '')))
+  click.echo('contender: {} ({})'.format(cont_ctx.get('commit', ''), cont_ctx.get('date', '')))
+  regressions = 0
+  for name, b in base.items():
+    if name not in cont:
+      continue
+    t_base = b[metric]
+    t_cont = cont[name][metric]
+    change = (t_cont - t_base) / t_base if t_base > 0 else 0.0
+    flag = ''
+    if change > threshold:
+      flag = 'REGRESSION'
+      regressions += 1
+    elif change < -threshold:
+      flag = 'improved'
+    click.echo('{:<70} {:>14.3f} {:>14.3f} {:>+8.1%} {}'.format(name, t_base, t_cont, change, flag))
+  click.echo('{} regressions'.format(regressions))
+  if regressions > 0:
+    raise SystemExit(1)
+
+
+if __name__ == '__main__':
+  compare()
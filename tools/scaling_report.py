@@ -0,0 +1,39 @@
+#    Copyright (C) 2022 Amirabbas Asadi , All Rights Reserved
+#    distributed under Apache-2.0 license
+
+import json
+import sys
+
+if(len(sys.argv) < 2):
+  raise ValueError("you should pass the path of the scaling records.")
+
+records = []
+with open(sys.argv[1]) as fp:
+  for line in fp:
+    if line.strip():
+      records.append(json.loads(line))
+
+# group the records by flow and scaling mode
+groups = {}
+for r in records:
+  groups.setdefault((r['flow'], r['mode']), []).append(r)
+
+for (flow, mode), runs in sorted(groups.items()):
+  runs.sort(key=lambda r: (r['cores'], r['procs']))
+  base = runs[0]
+  print('{} / {} scaling'.format(flow, mode))
+  print('{:>6} {:>8} {:>6} {:>12} {:>10} {:>11} {:>11}'.format('procs', 'threads', 'cores', 'wall(s)', 'speedup', 'efficiency', 'comm share'))
+  for r in runs:
+    speedup = base['wall_time'] / r['wall_time']
+    cores = r['cores'] / base['cores']
+    # strong scaling: the same work is divided between more cores
+    # weak scaling: the work grows with the cores so the ideal time is constant
+    # a population clamped to a minimum per process makes the total work grow in strong scaling as well
+    if mode == 'strong':
+      work = (r['particles_per_proc'] * r['procs']) / (base['particles_per_proc'] * base['procs'])
+      efficiency = speedup * work / cores
+    else:
+      efficiency = speedup
+    print('{:>6} {:>8} {:>6} {:>12.3f} {:>10.2f} {:>10.1%} {:>10.1%}'.format(
+      r['procs'], r['threads'], r['cores'], r['wall_time'], speedup, efficiency, r['comm_share']))
+  print()